@@ -0,0 +1,316 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// eva
+#include <base/error.h>
+#include <rng/srng64.h>
+
+// bb
+#include <board.h>
+#include <bot.h>
+#include <clock.h>
+
+// -----------------------------------------------------------------------------
+// Microbenchmarks of the board and bot hot paths.
+// -----------------------------------------------------------------------------
+//
+// Each benchmark is calibrated first: the batch size doubles until one batch
+// takes at least SAMPLE_NS, which also warms up caches and branch predictors.
+// Then NUM_SAMPLES batches are timed and summarized per op:
+//
+//   name (ns/op)                ops/sample      median         p99        mean
+//   boardWinner/mid                 131072        14.4        15.0        14.5
+//
+// All inputs come from fixed seeds, so runs are repeatable. Run with
+// `make bench RELEASE=1`; BENCH=<substring> selects benchmarks by name.
+
+#define SAMPLE_NS   (1000 * 1000)  // 1ms.
+#define NUM_SAMPLES 101
+#define MAX_BATCH   (1 << 24)
+
+static int
+cmpDouble(const void *a, const void *b)
+{
+        const double x = *(const double *)a;
+        const double y = *(const double *)b;
+        return (x > y) - (x < y);
+}
+
+// -----------------------------------------------------------------------------
+// positions.
+// -----------------------------------------------------------------------------
+
+#define NUM_POSITIONS 64
+
+enum { STAGE_EARLY = 0, STAGE_MID, STAGE_LATE, NUM_STAGES };
+
+static const int stage_stones[NUM_STAGES] = {4, 16, 30};
+
+// random 6x7 positions without a winner, per stage, and the last move of
+// each, which the bots need to find the side to move.
+struct position_t {
+        struct board_t *b;
+        int             prev_r;
+        int             prev_c;
+};
+
+static struct position_t positions[NUM_STAGES][NUM_POSITIONS];
+static struct board_t   *empty;
+static struct board_t   *scratch;
+static volatile int      sink;  // keeps results alive.
+
+// places up to 'stones' random stones; a column completing a line is skipped.
+static void
+positionInit(struct position_t *p, int stones, struct rng64_t *rng)
+{
+        enum player_t color = PLAYER_BLACK;
+
+        p->b      = boardNew(6, 7, 4, 1);
+        p->prev_r = -1;
+        p->prev_c = -1;
+
+        for (int n = 0, tries = 0; n < stones && tries < 1000; tries++) {
+                int col = rng64NextUint64(rng) % p->b->cols;
+                int row = boardRowForCol(p->b, col);
+                if (row == -1) continue;
+
+                boardSet(p->b, row, col, color, 0);
+                if (boardWinnerAt(p->b, row, col) != PLAYER_NA) {
+                        boardSet(p->b, row, col, PLAYER_NA, 0);
+                        continue;
+                }
+                p->prev_r = row;
+                p->prev_c = col;
+                color     = color == PLAYER_BLACK ? PLAYER_WHITE : PLAYER_BLACK;
+                n++;
+        }
+}
+
+static void
+positionsInit(uint64_t seed)
+{
+        struct rng64_t *rng = srng64New(seed);
+        for (int s = 0; s < NUM_STAGES; s++) {
+                for (int i = 0; i < NUM_POSITIONS; i++) {
+                        positionInit(&positions[s][i], stage_stones[s], rng);
+                }
+        }
+        empty   = boardNew(6, 7, 4, 1);
+        scratch = boardNew(6, 7, 4, 1);
+        rng64Free(rng);
+}
+
+static void
+positionsFree(void)
+{
+        for (int s = 0; s < NUM_STAGES; s++) {
+                for (int i = 0; i < NUM_POSITIONS; i++) {
+                        boardFree(positions[s][i].b);
+                }
+        }
+        boardFree(empty);
+        boardFree(scratch);
+}
+
+// -----------------------------------------------------------------------------
+// workloads.
+// -----------------------------------------------------------------------------
+
+static void
+runNew(int ops, void *ctx)
+{
+        int acc = 0;
+        for (int i = 0; i < ops; i++) {
+                struct board_t *b = boardNew(6, 7, 4, 1);
+                acc += b->cols;
+                boardFree(b);
+        }
+        sink = acc;
+}
+
+// fills the bottom row and clears it again; one op is one boardSet.
+static void
+runSet(int ops, void *ctx)
+{
+        int i = 0;
+        while (i < ops) {
+                for (int c = 0; c < 7 && i < ops; c++, i++) {
+                        boardSet(scratch, 0, c, PLAYER_BLACK, 0);
+                }
+                for (int c = 0; c < 7 && i < ops; c++, i++) {
+                        boardSet(scratch, 0, c, PLAYER_NA, 0);
+                }
+        }
+}
+
+static void
+runGet(int ops, void *ctx)
+{
+        struct board_t *b   = positions[STAGE_MID][0].b;
+        int             acc = 0;
+        for (int i = 0; i < ops; i++) {
+                int v;
+                boardGet(b, i % 6, i % 7, &v);
+                acc += v;
+        }
+        sink = acc;
+}
+
+static void
+runRowForCol(int ops, void *ctx)
+{
+        int acc = 0;
+        for (int i = 0; i < ops; i++) {
+                struct board_t *b = positions[STAGE_MID][i % NUM_POSITIONS].b;
+                acc += boardRowForCol(b, i % 7);
+        }
+        sink = acc;
+}
+
+// 'ctx' points to the stage.
+static void
+runWinner(int ops, void *ctx)
+{
+        const int stage = *(const int *)ctx;
+        int       acc   = 0;
+        for (int i = 0; i < ops; i++) {
+                acc += boardWinner(positions[stage][i % NUM_POSITIONS].b);
+        }
+        sink = acc;
+}
+
+// full random games from the empty board.
+static void
+runGame(int ops, void *ctx)
+{
+        struct rng64_t *rng = ctx;
+        int             acc = 0;
+        for (int i = 0; i < ops; i++) {
+                boardCopy(scratch, empty);
+                acc += boardPlayout(scratch, PLAYER_BLACK, rng, NULL, NULL);
+        }
+        sink = acc;
+}
+
+// calls bot_fn directly, so the tactics and telemetry of botPlay are not
+// measured. positions are midgames.
+static void
+runBotFn(int ops, void *ctx)
+{
+        struct bot_t      *bot = ctx;
+        struct bot_stats_t stats;
+        int                acc = 0;
+        for (int i = 0; i < ops; i++) {
+                struct position_t *p = &positions[STAGE_MID][i % NUM_POSITIONS];
+                int                r, c;
+                memset(&stats, 0, sizeof(stats));
+                bot->bot_fn(p->b, bot->data, p->prev_r, p->prev_c, &r, &c,
+                            &stats);
+                acc += c;
+        }
+        sink = acc;
+}
+
+// -----------------------------------------------------------------------------
+// runner.
+// -----------------------------------------------------------------------------
+
+struct bench_t {
+        const char *name;
+        void (*fn)(int ops, void *ctx);
+        void *ctx;
+};
+
+// returns the ns per op of the median sample.
+static double
+runBench(const struct bench_t *b)
+{
+        // calibration doubles as the warm up.
+        int batch = 1;
+        for (;;) {
+                uint64_t start = nowNs();
+                b->fn(batch, b->ctx);
+                if (nowNs() - start >= SAMPLE_NS || batch >= MAX_BATCH) break;
+                batch *= 2;
+        }
+
+        double samples[NUM_SAMPLES];
+        double sum = 0;
+        for (int i = 0; i < NUM_SAMPLES; i++) {
+                uint64_t start = nowNs();
+                b->fn(batch, b->ctx);
+                samples[i] = (double)(nowNs() - start) / batch;
+                sum += samples[i];
+        }
+        qsort(samples, NUM_SAMPLES, sizeof(double), cmpDouble);
+
+        const double median = samples[NUM_SAMPLES / 2];
+        const double p99    = samples[(int)(0.99 * (NUM_SAMPLES - 1))];
+        printf("%-24s %14d %11.1f %11.1f %11.1f\n", b->name, batch, median,
+               p99, sum / NUM_SAMPLES);
+        return median;
+}
+
+// -----------------------------------------------------------------------------
+// main.
+// -----------------------------------------------------------------------------
+
+// usage: bench [name substring]
+int
+main(int argc, char **argv)
+{
+        const char *filter = argc > 1 ? argv[1] : "";
+
+        positionsInit(/*seed=*/23);
+
+        struct rng64_t   *rng  = srng64New(/*seed=*/7);
+        struct bot_opts_t opts = {
+            .seed          = 23,
+            .mcts_playouts = 1000,
+            .ab_depth      = 8,
+        };
+        struct bot_t *bots[] = {
+            botNewDeterministic("deterministic", "", /*try_sleep=*/0),
+            botNewRandom("random", "", /*seed=*/23),
+            botNewMCTS("mcts", "", &opts),
+            botNewAlphaBeta("ab", "", &opts),
+        };
+
+        static int stages[NUM_STAGES] = {STAGE_EARLY, STAGE_MID, STAGE_LATE};
+
+        const struct bench_t benches[] = {
+            {"boardNew", runNew, NULL},
+            {"boardSet", runSet, NULL},
+            {"boardGet", runGet, NULL},
+            {"boardRowForCol", runRowForCol, NULL},
+            {"boardWinner/early", runWinner, &stages[STAGE_EARLY]},
+            {"boardWinner/mid", runWinner, &stages[STAGE_MID]},
+            {"boardWinner/late", runWinner, &stages[STAGE_LATE]},
+            {"game/random", runGame, rng},
+            {"bot/deterministic", runBotFn, bots[0]},
+            {"bot/random", runBotFn, bots[1]},
+            {"bot/mcts", runBotFn, bots[2]},
+            {"bot/ab", runBotFn, bots[3]},
+        };
+
+        printf("%-24s %14s %11s %11s %11s\n", "name (ns/op)", "ops/sample",
+               "median", "p99", "mean");
+        for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+                if (strstr(benches[i].name, filter) == NULL) continue;
+
+                double ns = runBench(&benches[i]);
+                if (benches[i].fn == runGame) {
+                        printf("%-24s %14s %11.0f\n", "  games/s", "",
+                               1e9 / ns);
+                }
+        }
+
+        for (size_t i = 0; i < sizeof(bots) / sizeof(bots[0]); i++) {
+                botFree(bots[i]);
+        }
+        rng64Free(rng);
+        positionsFree();
+        return 0;
+}
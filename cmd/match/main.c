@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>  // getopt
+
+// eva
+#include <base/error.h>
+
+// bb
+#include <bot.h>
+#include <evcache.h>
+#include <match.h>
+#include <pns.h>
+#include <record.h>
+#include <trace.h>
+
+#ifdef BB_NN
+#include <broker.h>
+#include <nn.h>
+#include <weights.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define TRACE_PATH "match_trace.json"
+
+// a standard 6x7 board for connect 4.
+#define ROWS       6
+#define COLS       7
+#define NUM_TO_WIN 4
+
+#ifdef BB_NN
+#define OPTSTRING "c:rRs:pb:w:"
+#define USAGE                                                                  \
+        "usage: %s [-r] [-R] [-s nodes] [-c mb] [-p] [-b batch] [-w seed] "    \
+        "[games] [record file]\n"
+#else
+#define OPTSTRING "c:rRs:"
+#define USAGE                                                                  \
+        "usage: %s [-r] [-R] [-s nodes] [-c mb] [games] [record file]\n"
+#endif
+
+static void
+printGame(const struct match_game_t *g, void *ctx)
+{
+        struct bot_t **bots = ctx;
+        sds_t          s    = sdsEmpty();
+        matchGameSummary(g, bots[0], bots[1], &s);
+        printf("%s", s);
+        sdsFree(s);
+}
+
+#ifdef BB_NN
+// what the puct bot evaluates through, besides its own network.
+struct nn_path_t {
+        struct nn_t             *nn;       // owned. behind the broker.
+        struct broker_t         *broker;   // owned. NULL-able.
+        struct weights_handle_t *weights;  // owned. NULL-able.
+};
+
+// with 'seed' > 0, publishes the initial weights of a network of that seed,
+// which all networks of the bots load in place of their own. with 'batch' > 0,
+// starts a broker over one network evaluating up to 'batch' boards at once.
+// sets the broker and the weights of 'opts'.
+static error_t
+nnPathNew(int batch, uint64_t seed, struct bot_opts_t *opts,
+          struct nn_path_t *p)
+{
+        struct nn_opts_t nn_opts = {
+            .rows   = ROWS,
+            .cols   = COLS,
+            .batch  = batch,
+            .hidden = opts->nn_hidden,
+            .seed   = seed,
+        };
+        error_t err;
+
+        if (seed > 0) {
+                struct nn_t *source;
+                uint64_t     version;
+
+                err = nnNew(&nn_opts, &source);
+                if (err) return errEmitNote("failed to build the network.");
+
+                p->weights = weightsHandleNew();
+                err        = nnPublishWeights(p->weights, source, &version);
+                nnFree(source);
+                if (err) return errEmitNote("failed to publish the weights.");
+        }
+
+        if (batch > 0) {
+                nn_opts.seed = opts->seed;
+                err          = nnNew(&nn_opts, &p->nn);
+                if (err) return errEmitNote("failed to build the network.");
+                if (p->weights != NULL) {
+                        err = nnAttach(p->nn, p->weights);
+                        if (err) {
+                                return errEmitNote(
+                                    "failed to attach the weights.");
+                        }
+                }
+
+                const struct broker_opts_t broker_opts = {
+                    .cols       = COLS,
+                    .batch      = batch,
+                    .timeout_ns = 1000 * 1000,
+                };
+                err = brokerNew(&broker_opts, nnEval, p->nn, &p->broker);
+                if (err) return errEmitNote("failed to start the broker.");
+        }
+
+        opts->broker  = p->broker;
+        opts->weights = p->weights;
+        return OK;
+}
+
+// after all bots using 'p' are freed.
+static void
+nnPathFree(struct nn_path_t *p)
+{
+        if (p->broker != NULL) brokerFree(p->broker);
+        nnFree(p->nn);
+        if (p->weights != NULL) weightsHandleFree(p->weights);
+}
+
+static void
+printBroker(struct broker_t *broker)
+{
+        struct broker_stats_t st;
+        brokerStats(broker, &st);
+        printf("  broker: %llu batches, %.1f%% occupancy, %llu full, "
+               "wait p50 %.2f ms, p99 %.2f ms, eval %.2f ms/batch\n",
+               (unsigned long long)st.batches, 100.0 * st.occupancy,
+               (unsigned long long)st.full, st.wait_ns_p50 / 1e6,
+               st.wait_ns_p99 / 1e6, st.eval_ns_mean / 1e6);
+}
+#endif  // BB_NN
+
+// -----------------------------------------------------------------------------
+// main.
+// -----------------------------------------------------------------------------
+
+// usage: match [-r] [-R] [-s nodes] [-c mb] [-p] [-b batch] [-w seed] [games]
+//              [record file]
+//
+//   -c  the alpha-beta bot caches its evaluations in 'mb' MB, and the report
+//       includes the hit rate of the cache.
+//   -r  the mcts bot uses RAVE.
+//   -R  pits mcts with RAVE against plain mcts, instead of alpha-beta.
+//   -s  checks every move with the df-pn solver, within 'nodes' nodes per
+//       position, and counts the moves giving up a win or a draw.
+//
+// built with NN=1, also:
+//
+//   -p  pits the puct bot, guided by an untrained network, against
+//       alpha-beta, instead of mcts.
+//   -b  the puct bot evaluates through a broker batching up to 'batch'
+//       boards. implies -p.
+//   -w  the networks load the weights of a network of 'seed', published
+//       through a weights handle as a trainer would. implies -p.
+int
+main(int argc, char **argv)
+{
+        int      rave        = 0;
+        int      rave_pair   = 0;
+        uint64_t solve_nodes = 0;
+        size_t   cache_mb    = 0;
+
+#ifdef BB_NN
+        int      puct         = 0;
+        int      broker_batch = 0;
+        uint64_t weights_seed = 0;
+#endif
+
+        int opt;
+        while ((opt = getopt(argc, argv, OPTSTRING)) != -1) {
+                switch (opt) {
+                case 'c': cache_mb = strtoull(optarg, NULL, 10); break;
+                case 'r': rave = 1; break;
+                case 'R': rave_pair = 1; break;
+                case 's': solve_nodes = strtoull(optarg, NULL, 10); break;
+#ifdef BB_NN
+                case 'p': puct = 1; break;
+                case 'b':
+                        puct         = 1;
+                        broker_batch = atoi(optarg);
+                        break;
+                case 'w':
+                        puct         = 1;
+                        weights_seed = strtoull(optarg, NULL, 10);
+                        break;
+#endif
+                default: fprintf(stderr, USAGE, argv[0]); return 1;
+                }
+        }
+        argc -= optind - 1;
+        argv += optind - 1;
+
+        const int   games       = argc > 1 ? atoi(argv[1]) : 10;
+        const char *record_path = argc > 2 ? argv[2] : NULL;
+        error_t     err         = OK;
+
+        // one table for both bots, which search in turn.
+        struct tt_t *tt = ttNew(64 * 1024 * 1024, TT_POLICY_TWO_TIER);
+        if (tt == NULL) {
+                fprintf(stderr, "failed to allocate the table.\n");
+                return 1;
+        }
+
+        // shared by the bots the same way. freed after them.
+        struct evcache_t *cache = NULL;
+        if (cache_mb > 0) {
+                cache = evcacheNew(cache_mb * 1024 * 1024);
+                if (cache == NULL) {
+                        fprintf(stderr, "failed to allocate the cache.\n");
+                        ttFree(tt);
+                        return 1;
+                }
+        }
+
+        struct bot_opts_t opts = {
+            .seed          = 23,
+            .tt            = tt,
+            .eval_cache    = cache,
+            .mcts_playouts = 20000,
+            .mcts_rave     = rave || rave_pair,
+            .ab_depth      = 10,
+        };
+
+#ifdef BB_NN
+        struct nn_path_t nn_path = {0};
+        if (puct) {
+                err = nnPathNew(broker_batch, weights_seed, &opts, &nn_path);
+                if (err) {
+                        nnPathFree(&nn_path);
+                        evcacheFree(cache);
+                        ttFree(tt);
+                        errDump("failed to set up the network.");
+                        return 1;
+                }
+        }
+#endif
+
+        struct bot_t *bots[2];
+#ifdef BB_NN
+        if (puct) {
+                bots[0] = botNewPUCT("puct", "puct", &opts);
+                bots[1] = botNewAlphaBeta("ab", "alpha-beta", &opts);
+        } else
+#endif
+        if (rave_pair) {
+                bots[0] = botNewMCTS("rave", "mcts with RAVE", &opts);
+                opts.mcts_rave = 0;
+                bots[1]        = botNewMCTS("mcts", "mcts", &opts);
+        } else {
+                bots[0] = botNewMCTS(rave ? "rave" : "mcts", "mcts", &opts);
+                bots[1] = botNewAlphaBeta("ab", "alpha-beta", &opts);
+        }
+
+        struct match_opts_t match_opts = {
+            .rows       = ROWS,
+            .cols       = COLS,
+            .num_to_win = NUM_TO_WIN,
+            .games      = games,
+            .swap       = 1,
+            .on_game    = printGame,
+            .ctx        = bots,
+            .eval_cache = cache,
+        };
+
+        if (solve_nodes > 0) {
+                match_opts.solver      = pnsNew(64 * 1024 * 1024);
+                match_opts.solve_nodes = solve_nodes;
+                if (match_opts.solver == NULL) {
+                        err = errNew("failed to allocate the solver.");
+                        goto exit;
+                }
+        }
+
+        // games are appended to the record file, if any.
+        if (record_path != NULL) {
+                struct record_header_t h;
+                matchRecordHeader(&match_opts, &h);
+                err = recordWriterOpen(record_path, &h, &match_opts.records);
+                if (err) goto exit;
+        }
+
+        // the whole match is traced, drained as it goes. no-op unless built
+        // with TRACE=1.
+        const int traced = TRACE_OPEN(TRACE_PATH) == 0;
+        if (!traced) fprintf(stderr, "failed to open %s.\n", TRACE_PATH);
+
+        struct match_report_t report;
+        err = matchPlay(&match_opts, bots[0], bots[1], &report);
+        if (traced && TRACE_CLOSE() != 0) {
+                fprintf(stderr, "failed to write %s.\n", TRACE_PATH);
+        }
+        if (!err) {
+                sds_t s = sdsEmpty();
+                matchReportSummary(&report, bots[0], bots[1], &s);
+                printf("%s", s);
+                sdsFree(s);
+#ifdef BB_NN
+                if (nn_path.broker != NULL) printBroker(nn_path.broker);
+#endif
+        }
+
+exit:
+        if (match_opts.records != NULL) {
+                error_t close_err = recordWriterClose(match_opts.records);
+                if (!err) err = close_err;
+        }
+        pnsFree(match_opts.solver);
+        botFree(bots[0]);
+        botFree(bots[1]);
+#ifdef BB_NN
+        nnPathFree(&nn_path);
+#endif
+        evcacheFree(cache);
+        ttFree(tt);
+
+        if (err) {
+                errDump("unexpected error.");
+                return 1;
+        }
+        return 0;
+}
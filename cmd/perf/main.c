@@ -0,0 +1,359 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+// eva
+#include <base/error.h>
+#include <rng/srng64.h>
+
+// bb
+#include <board.h>
+#include <bot.h>
+#include <clock.h>
+
+// -----------------------------------------------------------------------------
+// Hardware counters of the hot paths, via perf_event_open(2).
+// -----------------------------------------------------------------------------
+//
+// Each benchmark runs its workload once to warm up, then again with all
+// counters enabled as one group, so they cover the same instructions. The
+// results are printed as JSON on stdout:
+//
+//   {"counters": true, "benchmarks": [{"name": ..., "ops": ...,
+//     "ns_per_op": ..., "cycles": ..., "instructions": ..., "ipc": ...,
+//     "branch_misses": ..., "l1d_misses": ..., "llc_misses": ...}, ...]}
+//
+// Counters are per op. If the kernel refuses perf events (see
+// /proc/sys/kernel/perf_event_paranoid), or off Linux, "counters" is false and
+// only wall times are reported.
+
+// -----------------------------------------------------------------------------
+// counters.
+// -----------------------------------------------------------------------------
+
+enum {
+        CNT_CYCLES = 0,
+        CNT_INSTRUCTIONS,
+        CNT_BRANCH_MISSES,
+        CNT_L1D_MISSES,
+        CNT_LLC_MISSES,
+        NUM_CNTS,
+};
+
+static const char *cnt_names[NUM_CNTS] = {
+    "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses",
+};
+
+struct counters_t {
+        int fds[NUM_CNTS];  // -1 if not available. fds[0] leads the group.
+        int available;      // 1 if the group leader opened.
+};
+
+#ifdef __linux__
+
+#define CACHE_READ_MISS(cache)                                     \
+        ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) |            \
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct {
+        uint32_t type;
+        uint64_t config;
+} cnt_events[NUM_CNTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL)},
+};
+
+// layout of a group read with PERF_FORMAT_GROUP.
+struct group_read_t {
+        uint64_t nr;
+        uint64_t values[NUM_CNTS];
+};
+
+static int
+perfOpen(uint32_t type, uint64_t config, int group_fd)
+{
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = type;
+        attr.config         = config;
+        attr.disabled       = group_fd == -1;  // the leader starts the group.
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP;
+
+        return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+// opens the group. events the cpu lacks are skipped.
+static void
+countersOpen(struct counters_t *c)
+{
+        c->fds[0]    = perfOpen(cnt_events[0].type, cnt_events[0].config, -1);
+        c->available = c->fds[0] != -1;
+        for (int i = 1; i < NUM_CNTS; i++) {
+                c->fds[i] = c->available ? perfOpen(cnt_events[i].type,
+                                                    cnt_events[i].config,
+                                                    c->fds[0])
+                                         : -1;
+        }
+}
+
+static void
+countersClose(struct counters_t *c)
+{
+        for (int i = 0; i < NUM_CNTS; i++) {
+                if (c->fds[i] != -1) close(c->fds[i]);
+        }
+}
+
+static void
+countersStart(struct counters_t *c)
+{
+        if (!c->available) return;
+        ioctl(c->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(c->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// fills 'values' in enum order; -1 for events not available.
+static void
+countersStop(struct counters_t *c, int64_t *values)
+{
+        for (int i = 0; i < NUM_CNTS; i++) values[i] = -1;
+        if (!c->available) return;
+
+        ioctl(c->fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // the group read lists the opened events in creation order.
+        struct group_read_t r;
+        if (read(c->fds[0], &r, sizeof(r)) <= 0) return;
+
+        uint64_t j = 0;
+        for (int i = 0; i < NUM_CNTS && j < r.nr; i++) {
+                if (c->fds[i] != -1) values[i] = r.values[j++];
+        }
+}
+
+#else  // __linux__
+
+// perf_event_open(2) is Linux only.
+static void
+countersOpen(struct counters_t *c)
+{
+        for (int i = 0; i < NUM_CNTS; i++) c->fds[i] = -1;
+        c->available = 0;
+}
+
+static void
+countersClose(struct counters_t *c)
+{
+}
+
+static void
+countersStart(struct counters_t *c)
+{
+}
+
+static void
+countersStop(struct counters_t *c, int64_t *values)
+{
+        for (int i = 0; i < NUM_CNTS; i++) values[i] = -1;
+}
+
+#endif  // __linux__
+
+// -----------------------------------------------------------------------------
+// workloads.
+// -----------------------------------------------------------------------------
+
+#define NUM_POSITIONS 64
+
+// shared by the workloads. positions are random midgames without a winner.
+static struct board_t *positions[NUM_POSITIONS];
+static int             last_moves[NUM_POSITIONS][2];  // row, col.
+static struct board_t *scratch;
+static volatile int    sink;  // keeps results alive.
+
+static void
+positionsInit(uint64_t seed)
+{
+        struct rng64_t *rng = srng64New(seed);
+        for (int i = 0; i < NUM_POSITIONS; i++) {
+                struct board_t *b     = boardNew(6, 7, 4, 1);
+                enum player_t   color = PLAYER_BLACK;
+
+                last_moves[i][0] = -1;
+                last_moves[i][1] = -1;
+                for (int n = 0; n < 16; n++) {
+                        int col = rng64NextUint64(rng) % b->cols;
+                        int row = boardRowForCol(b, col);
+                        if (row == -1) continue;
+
+                        boardSet(b, row, col, color, 0);
+                        if (boardWinnerAt(b, row, col) != PLAYER_NA) {
+                                boardSet(b, row, col, PLAYER_NA, 0);
+                                break;
+                        }
+                        last_moves[i][0] = row;
+                        last_moves[i][1] = col;
+                        color = color == PLAYER_BLACK ? PLAYER_WHITE
+                                                      : PLAYER_BLACK;
+                }
+                positions[i] = b;
+        }
+        scratch = boardClone(positions[0]);
+        rng64Free(rng);
+}
+
+static void
+positionsFree(void)
+{
+        for (int i = 0; i < NUM_POSITIONS; i++) boardFree(positions[i]);
+        boardFree(scratch);
+}
+
+static void
+runWinner(int ops, void *ctx)
+{
+        int acc = 0;
+        for (int i = 0; i < ops; i++) {
+                acc += boardWinner(positions[i % NUM_POSITIONS]);
+        }
+        sink = acc;
+}
+
+static void
+runRowForCol(int ops, void *ctx)
+{
+        int acc = 0;
+        for (int i = 0; i < ops; i++) {
+                acc += boardRowForCol(positions[i % NUM_POSITIONS], i % 7);
+        }
+        sink = acc;
+}
+
+static void
+runPlayout(int ops, void *ctx)
+{
+        struct rng64_t *rng = ctx;
+        int             acc = 0;
+        for (int i = 0; i < ops; i++) {
+                boardCopy(scratch, positions[i % NUM_POSITIONS]);
+                acc += boardPlayout(scratch, PLAYER_BLACK, rng, NULL, NULL);
+        }
+        sink = acc;
+}
+
+// one move of the bot in 'ctx' from the midgame positions.
+static void
+runBotMove(int ops, void *ctx)
+{
+        struct bot_t *bot = ctx;
+        int           acc = 0;
+        for (int i = 0; i < ops; i++) {
+                const int j = i % NUM_POSITIONS;
+                int       r, c;
+                botPlay(bot, positions[j], last_moves[j][0], last_moves[j][1],
+                        &r, &c);
+                acc += c;
+        }
+        sink = acc;
+}
+
+// -----------------------------------------------------------------------------
+// main.
+// -----------------------------------------------------------------------------
+
+struct bench_t {
+        const char *name;
+        void (*fn)(int ops, void *ctx);
+        void *ctx;
+        int   ops;
+};
+
+static void
+runBench(struct counters_t *c, const struct bench_t *b, int first)
+{
+        int64_t values[NUM_CNTS];
+
+        b->fn(b->ops, b->ctx);  // warm up.
+
+        uint64_t start = nowNs();
+        countersStart(c);
+        b->fn(b->ops, b->ctx);
+        countersStop(c, values);
+        uint64_t ns = nowNs() - start;
+
+        printf("%s\n    {\"name\": \"%s\", \"ops\": %d, \"ns_per_op\": %.3f",
+               first ? "" : ",", b->name, b->ops, (double)ns / b->ops);
+        for (int i = 0; i < NUM_CNTS; i++) {
+                if (values[i] < 0) {
+                        printf(", \"%s\": null", cnt_names[i]);
+                } else {
+                        printf(", \"%s\": %.3f", cnt_names[i],
+                               (double)values[i] / b->ops);
+                }
+        }
+        if (values[CNT_CYCLES] > 0 && values[CNT_INSTRUCTIONS] >= 0) {
+                printf(", \"ipc\": %.3f", (double)values[CNT_INSTRUCTIONS] /
+                                              values[CNT_CYCLES]);
+        } else {
+                printf(", \"ipc\": null");
+        }
+        printf("}");
+}
+
+int
+main()
+{
+        positionsInit(/*seed=*/23);
+
+        struct rng64_t   *rng  = srng64New(/*seed=*/7);
+        struct bot_opts_t opts = {
+            .seed          = 23,
+            .mcts_playouts = 2000,
+            .ab_depth      = 8,
+        };
+        struct bot_t *mcts = botNewMCTS("mcts", "", &opts);
+        struct bot_t *ab   = botNewAlphaBeta("ab", "", &opts);
+
+        // times the searches, not the forced moves found before them.
+        mcts->tactics = 0;
+        ab->tactics   = 0;
+
+        const struct bench_t benches[] = {
+            {"boardWinner", runWinner, NULL, 1000000},
+            {"boardRowForCol", runRowForCol, NULL, 10000000},
+            {"boardPlayout", runPlayout, rng, 100000},
+            {"botMoveMCTS", runBotMove, mcts, 20},
+            {"botMoveAlphaBeta", runBotMove, ab, 20},
+        };
+
+        struct counters_t c;
+        countersOpen(&c);
+
+        printf("{\"counters\": %s, \"benchmarks\": [",
+               c.available ? "true" : "false");
+        for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+                runBench(&c, &benches[i], i == 0);
+        }
+        printf("\n]}\n");
+
+        countersClose(&c);
+        botFree(mcts);
+        botFree(ab);
+        rng64Free(rng);
+        positionsFree();
+        return 0;
+}
@@ -0,0 +1,275 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>  // getopt
+
+// eva
+#include <base/error.h>
+
+// bb
+#include <board.h>
+#include <clock.h>
+
+// -----------------------------------------------------------------------------
+// Perft: counts the leaf positions at a fixed depth.
+// -----------------------------------------------------------------------------
+//
+// Every legal move sequence of exactly 'depth' plies is a leaf. A move that
+// wins or fills the board ends its sequence, so it only counts at the last ply.
+// Counting all sequences exercises boardRowForCol, boardSet and boardWinnerAt
+// of the chosen backend; the counts are checked against the known ones for the
+// standard 6x7 board, and positions/sec compares backends.
+//
+// usage: perft [-d depth] [-t threads] [-r rows] [-c cols] [-k num_to_win]
+//              [-g] [-m moves]
+//
+//   -g  uses the generic bitset kernels instead of the specialized ones.
+//   -m  columns played from the empty board first, e.g., "3342".
+//
+// With -t > 1, the positions PERFT_SPLIT plies below the root are shared out
+// to the threads, each searching its own copy of the board.
+
+#define PERFT_SPLIT 2
+
+// leaves of the empty 6x7 board, connect 4, by depth.
+static const uint64_t known_6x7[] = {
+    1, 7, 49, 343, 2401, 16807, 117649, 823536, 5673234, 39394572,
+};
+
+#define NUM_KNOWN (int)(sizeof(known_6x7) / sizeof(known_6x7[0]))
+
+// -----------------------------------------------------------------------------
+// search.
+// -----------------------------------------------------------------------------
+
+static uint64_t
+perft(struct board_t *b, enum player_t next, int depth)
+{
+        if (depth == 0) return 1;
+
+        uint64_t leaves = 0;
+        for (int col = 0; col < b->cols; col++) {
+                int row = boardRowForCol(b, col);
+                if (row == -1) continue;
+
+                boardSet(b, row, col, next, 0);
+                if (boardWinnerAt(b, row, col) == PLAYER_NA) {
+                        leaves += perft(b, NEXT_PLAYER(next), depth - 1);
+                } else {
+                        leaves += depth == 1;  // the game ended.
+                }
+                boardSet(b, row, col, PLAYER_NA, 0);
+        }
+        return leaves;
+}
+
+// a subtree for the threads: the moves from the root to it.
+struct task_t {
+        uint8_t moves[PERFT_SPLIT];
+        int     num_moves;
+};
+
+struct split_t {
+        const struct board_t *root;
+        enum player_t         next;
+        int                   depth;  // below the root.
+
+        struct task_t *tasks;
+        int            num_tasks;
+        uint64_t       leaves;  // of the sequences ending above the tasks.
+
+        atomic_int        next_task;
+        _Atomic(uint64_t) total;
+};
+
+// collects the positions 'split' plies below 'b' as tasks. returns the
+// leaves of the sequences which end before.
+static uint64_t
+splitCollect(struct split_t *s, struct board_t *b, enum player_t next,
+             int depth, int split, struct task_t *path)
+{
+        if (depth == 0) return 1;
+        if (split == 0) {
+                s->tasks[s->num_tasks++] = *path;
+                return 0;
+        }
+
+        uint64_t leaves = 0;
+        for (int col = 0; col < b->cols; col++) {
+                int row = boardRowForCol(b, col);
+                if (row == -1) continue;
+
+                boardSet(b, row, col, next, 0);
+                if (boardWinnerAt(b, row, col) == PLAYER_NA) {
+                        path->moves[path->num_moves++] = col;
+                        leaves += splitCollect(s, b, NEXT_PLAYER(next),
+                                               depth - 1, split - 1, path);
+                        path->num_moves--;
+                } else {
+                        leaves += depth == 1;
+                }
+                boardSet(b, row, col, PLAYER_NA, 0);
+        }
+        return leaves;
+}
+
+static void *
+splitWorker(void *arg)
+{
+        struct split_t *s = arg;
+        struct board_t *b = boardClone(s->root);
+
+        for (;;) {
+                int i = atomic_fetch_add(&s->next_task, 1);
+                if (i >= s->num_tasks) break;
+
+                const struct task_t *t = &s->tasks[i];
+
+                boardCopy(b, s->root);
+                enum player_t next = s->next;
+                for (int j = 0; j < t->num_moves; j++) {
+                        boardSet(b, boardRowForCol(b, t->moves[j]),
+                                 t->moves[j], next, 0);
+                        next = NEXT_PLAYER(next);
+                }
+                atomic_fetch_add(&s->total,
+                                 perft(b, next, s->depth - t->num_moves));
+        }
+
+        boardFree(b);
+        return NULL;
+}
+
+static uint64_t
+perftParallel(struct board_t *b, enum player_t next, int depth, int threads)
+{
+        if (threads <= 1 || depth <= PERFT_SPLIT) return perft(b, next, depth);
+
+        struct split_t s = {.root = b, .next = next, .depth = depth};
+
+        int max_tasks = 1;
+        for (int i = 0; i < PERFT_SPLIT; i++) max_tasks *= b->cols;
+        s.tasks = malloc(max_tasks * sizeof(struct task_t));
+
+        struct task_t path = {.num_moves = 0};
+        s.leaves = splitCollect(&s, b, next, depth, PERFT_SPLIT, &path);
+        atomic_init(&s.next_task, 0);
+        atomic_init(&s.total, s.leaves);
+
+        // the workers share out all tasks, so fewer threads only take
+        // longer. with none, the calling thread does them.
+        pthread_t *tids    = malloc(threads * sizeof(pthread_t));
+        int        started = 0;
+        for (; started < threads; started++) {
+                if (pthread_create(&tids[started], NULL, splitWorker, &s)) {
+                        fprintf(stderr, "failed to start thread %d of %d.\n",
+                                started, threads);
+                        break;
+                }
+        }
+        if (started == 0) splitWorker(&s);
+        for (int i = 0; i < started; i++) pthread_join(tids[i], NULL);
+
+        free(tids);
+        free(s.tasks);
+        return atomic_load(&s.total);
+}
+
+// -----------------------------------------------------------------------------
+// main.
+// -----------------------------------------------------------------------------
+
+// plays 'moves' from the empty board. returns the side to move.
+static error_t
+playMoves(struct board_t *b, const char *moves, _out_ enum player_t *next)
+{
+        *next = PLAYER_BLACK;
+        for (const char *p = moves; *p != '\0'; p++) {
+                int col = *p - '0';
+                int row = col >= 0 && col < b->cols ? boardRowForCol(b, col)
+                                                    : -1;
+                if (row == -1) {
+                        return errNew("illegal move '%c' at %d.", *p,
+                                      (int)(p - moves));
+                }
+                boardSet(b, row, col, *next, 0);
+                if (boardWinnerAt(b, row, col) != PLAYER_NA) {
+                        return errNew("game ended at move %d.",
+                                      (int)(p - moves));
+                }
+                *next = NEXT_PLAYER(*next);
+        }
+        return OK;
+}
+
+int
+main(int argc, char **argv)
+{
+        int         depth      = 8;
+        int         threads    = 1;
+        int         rows       = 6;
+        int         cols       = 7;
+        int         num_to_win = 4;
+        int         generic    = 0;
+        const char *moves      = "";
+
+        int opt;
+        while ((opt = getopt(argc, argv, "d:t:r:c:k:gm:")) != -1) {
+                switch (opt) {
+                case 'd': depth = atoi(optarg); break;
+                case 't': threads = atoi(optarg); break;
+                case 'r': rows = atoi(optarg); break;
+                case 'c': cols = atoi(optarg); break;
+                case 'k': num_to_win = atoi(optarg); break;
+                case 'g': generic = 1; break;
+                case 'm': moves = optarg; break;
+                default:
+                        fprintf(stderr,
+                                "usage: %s [-d depth] [-t threads] [-r rows] "
+                                "[-c cols] [-k num_to_win] [-g] [-m moves]\n",
+                                argv[0]);
+                        return 1;
+                }
+        }
+
+        struct board_t *b = boardNew(rows, cols, num_to_win, /*mode=*/1);
+        if (generic) boardUseGenericOps(b);
+
+        enum player_t next;
+        error_t       err = playMoves(b, moves, &next);
+        if (err) {
+                errDump("invalid -m.");
+                boardFree(b);
+                return 1;
+        }
+
+        // the known counts only apply to the empty standard board.
+        const int check = rows == 6 && cols == 7 && num_to_win == 4 &&
+                          moves[0] == '\0';
+
+        int failed = 0;
+        for (int d = 1; d <= depth; d++) {
+                uint64_t start  = nowNs();
+                uint64_t leaves = perftParallel(b, next, d, threads);
+                double   secs   = (nowNs() - start) / 1e9;
+
+                printf("depth %2d: %15llu leaves %9.3fs %12.0f pos/s",
+                       d, (unsigned long long)leaves, secs,
+                       secs > 0 ? leaves / secs : 0);
+                if (check && d < NUM_KNOWN) {
+                        if (leaves == known_6x7[d]) {
+                                printf("  ok");
+                        } else {
+                                printf("  MISMATCH (want %llu)",
+                                       (unsigned long long)known_6x7[d]);
+                                failed = 1;
+                        }
+                }
+                printf("\n");
+        }
+
+        boardFree(b);
+        return failed;
+}
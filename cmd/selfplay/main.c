@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>  // getopt
+
+// eva
+#include <base/error.h>
+#include <rng/srng64.h>
+
+// bb
+#include <encode.h>
+#include <replay.h>
+#include <selfplay.h>
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+static void
+printStats(const struct selfplay_stats_t *s, void *ctx)
+{
+        const double secs = s->wall_ns / 1e9;
+        printf("%8.1fs: %llu games, %llu samples, %.0f samples/s, "
+               "%.1f games/s, %.1f MB\n",
+               secs, (unsigned long long)s->games,
+               (unsigned long long)s->samples,
+               secs > 0 ? s->samples / secs : 0, secs > 0 ? s->games / secs : 0,
+               s->bytes / 1e6);
+        fflush(stdout);
+}
+
+// samples drawn from the replay buffer at the end, as one training batch.
+#define REPLAY_BATCH 256
+
+// draws a batch from 'r' as a trainer would and prints the buffer stats with
+// the mean value target of the batch.
+static error_t
+drawReplay(struct replay_t *r, const struct selfplay_opts_t *opts)
+{
+        const int x_size = ENCODE_PLANES * opts->rows * opts->cols;
+        float    *x      = malloc(sizeof(float) * REPLAY_BATCH * x_size);
+        float    *policy = malloc(sizeof(float) * REPLAY_BATCH * opts->cols);
+        float     value[REPLAY_BATCH];
+
+        struct rng64_t *rng = srng64New(opts->seed);
+        error_t         err = replaySample(r, rng, REPLAY_BATCH, x, policy,
+                                           value);
+        rng64Free(rng);
+        free(x);
+        free(policy);
+        if (err) return errEmitNote("failed to draw from the replay buffer.");
+
+        struct replay_stats_t st;
+        replayStats(r, &st);
+
+        double mean = 0;
+        for (int i = 0; i < REPLAY_BATCH; i++) mean += value[i];
+        printf("replay: %llu appended, %llu of %llu held, %llu retries, "
+               "mean value %.3f over %d draws\n",
+               (unsigned long long)st.appended, (unsigned long long)st.size,
+               (unsigned long long)st.capacity,
+               (unsigned long long)st.retries, mean / REPLAY_BATCH,
+               REPLAY_BATCH);
+        return OK;
+}
+
+// -----------------------------------------------------------------------------
+// main.
+// -----------------------------------------------------------------------------
+
+// usage: selfplay [-g games] [-t threads] [-p playouts] [-o prefix]
+//                 [-s shard MB] [-r replay MB]
+//
+//   -r  the games also go to a replay buffer of that many MB, as for a
+//       concurrent trainer, which draws one batch from it at the end.
+int
+main(int argc, char **argv)
+{
+        // a standard 6x7 board for connect 4.
+        struct selfplay_opts_t opts = {
+            .rows        = 6,
+            .cols        = 7,
+            .num_to_win  = 4,
+            .games       = 100,
+            .threads     = 0,
+            .playouts    = 800,
+            .temp_plies  = 8,
+            .seed        = 23,
+            .prefix      = "selfplay",
+            .shard_bytes = 64 * 1024 * 1024,
+            .on_progress = printStats,
+        };
+        size_t replay_mb = 0;
+
+        int opt;
+        while ((opt = getopt(argc, argv, "g:t:p:o:s:r:")) != -1) {
+                switch (opt) {
+                case 'g': opts.games = atoi(optarg); break;
+                case 't': opts.threads = atoi(optarg); break;
+                case 'p': opts.playouts = atoi(optarg); break;
+                case 'o': opts.prefix = optarg; break;
+                case 's':
+                        opts.shard_bytes = (size_t)atoi(optarg) * 1024 * 1024;
+                        break;
+                case 'r': replay_mb = strtoull(optarg, NULL, 10); break;
+                default:
+                        fprintf(stderr,
+                                "usage: %s [-g games] [-t threads] "
+                                "[-p playouts] [-o prefix] [-s shard MB] "
+                                "[-r replay MB]\n",
+                                argv[0]);
+                        return 1;
+                }
+        }
+
+        error_t err;
+        if (replay_mb > 0) {
+                const struct replay_opts_t replay_opts = {
+                    .rows       = opts.rows,
+                    .cols       = opts.cols,
+                    .num_to_win = opts.num_to_win,
+                    .bytes      = replay_mb * 1024 * 1024,
+                    .mirror     = 1,
+                };
+                err = replayNew(&replay_opts, &opts.replay);
+                if (err) {
+                        errDump("failed to create the replay buffer.");
+                        return 1;
+                }
+        }
+
+        struct selfplay_stats_t stats;
+        err = selfplayRun(&opts, &stats);
+        if (err) {
+                replayFree(opts.replay);
+                errDump("self-play failed.");
+                return 1;
+        }
+
+        printStats(&stats, NULL);
+        printf("black %llu, white %llu, draws %llu\n",
+               (unsigned long long)stats.wins[0],
+               (unsigned long long)stats.wins[1],
+               (unsigned long long)stats.wins[2]);
+
+        if (opts.replay != NULL) {
+                err = drawReplay(opts.replay, &opts);
+                replayFree(opts.replay);
+                if (err) {
+                        errDump("replay failed.");
+                        return 1;
+                }
+        }
+        return 0;
+}
@@ -173,6 +173,9 @@ struct bb_seq_module_t {
 struct bb_seq_module_t *bbSeqModuleNew();
 void                    bbSeqModuleFree(struct bb_seq_module_t *);
 
+// Compiles the module into 'p'. Without ctx->is_training, only the forward
+// pass of the layers is compiled and 'y', 'loss', 'opt' and 'metric' may be
+// absent; p->outputs then holds the output of the last layer.
 error_t bbCompileSeqModule(const struct bb_context_t *ctx,
                            struct bb_program_t *p, struct bb_seq_module_t *);
 
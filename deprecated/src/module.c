@@ -24,9 +24,10 @@ bbSeqModuleFree(struct bb_seq_module_t *m)
 {
         if (m == NULL) return;
 
-        bbLayerFree(m->loss);
+        // absent in modules compiled for inference only.
+        if (m->loss != NULL) bbLayerFree(m->loss);
         bbOptFree(m->opt);
-        bbLayerFree(m->metric);
+        if (m->metric != NULL) bbLayerFree(m->metric);
         srng64Free(m->r);
 
         for (size_t i = 0; i < vecSize(m->layers); i++) {
@@ -36,10 +37,70 @@ bbSeqModuleFree(struct bb_seq_module_t *m)
         free(m);
 }
 
+// Compiles the forward pass only. Used for inference, where the module has no
+// labels, loss, optimizer or metric.
+static error_t
+compileForward(const struct bb_context_t *ctx, struct bb_program_t *p,
+               struct bb_seq_module_t *m)
+{
+        vec_t(struct bb_layer_t *) layers = m->layers;
+
+        size_t  num_layers = vecSize(layers);
+        error_t err        = OK;
+        vec_t(int) inputs  = vecNew();
+        vec_t(int) outputs = vecNew();
+        vec_t(int) t;
+
+        vecPushBack(p->inputs, m->x);
+
+        for (int i = 0; i < num_layers; i++) {
+                struct bb_layer_t *l = layers[i];
+
+                err = l->ops.init(l, ctx, m->r);
+                if (err) {
+                        errEmitNote("failed to init %d-th layer", i);
+                        goto cleanup;
+                }
+                err = l->ops.weights(l, &p->weights);
+                if (err) {
+                        errEmitNote("failed to get weights of %d-th layer", i);
+                        goto cleanup;
+                }
+        }
+
+        vecPushBack(inputs, m->x);
+        for (int i = 0; i < num_layers; i++) {
+                struct bb_layer_t *l = layers[i];
+                err = l->ops.jit(l, ctx, p, BB_FORWARD, inputs, &outputs);
+                if (err) {
+                        errEmitNote("failed to jit %d-th layer", i);
+                        goto cleanup;
+                }
+
+                SWAP(inputs, outputs);
+                CLEAR(outputs);
+        }
+
+        assert(vecSize(inputs) == 1);
+        SWAP(inputs, p->outputs);
+
+cleanup:
+        vecFree(inputs);
+        vecFree(outputs);
+        return err;
+}
+
 error_t
 bbCompileSeqModule(const struct bb_context_t *ctx, struct bb_program_t *p,
                    struct bb_seq_module_t *m)
 {
+        if (!ctx->is_training) {
+                assert(m->x != 0);
+                assert(m->layers != NULL && vecSize(m->layers) > 0);
+                assert(m->r != NULL);
+                return compileForward(ctx, p, m);
+        }
+
         int x                             = m->x;
         int y                             = m->y;
         vec_t(struct bb_layer_t *) layers = m->layers;
@@ -0,0 +1,406 @@
+#include "ab.h"
+
+#include <stdlib.h>  // malloc, abs
+#include <string.h>  // memset
+
+// bb
+#include "trace.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define DEFAULT_DEPTH 12
+
+// scores beyond WIN_BOUND are wins; evaluations stay well below it.
+#define INF_SCORE (TT_SCORE_WIN + 1)
+#define WIN_BOUND (TT_SCORE_WIN / 2)
+#define EVAL_MAX  (TT_SCORE_WIN / 4)
+
+// history scores are halved when one reaches the limit.
+#define HISTORY_MAX (1u << 30)
+
+// ordering keys, in history units. a killer outweighs the center order, but
+// a move with a long history of cutoffs outweighs both.
+#define CENTER_WEIGHT 4096
+#define KILLER_BONUS  (8 * CENTER_WEIGHT)
+
+// lists all lines of num_to_win cells, as cell indices (row * cols + col).
+static void
+windowsInit(struct ab_t *a, struct board_t *b)
+{
+        const int rows = b->rows;
+        const int cols = b->cols;
+        const int k    = b->num_to_win;
+        const int dirs[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+        free(a->windows);
+        a->windows     = malloc(4 * rows * cols * k * sizeof(*a->windows));
+        a->num_windows = 0;
+
+        for (int r = 0; r < rows; r++) {
+                for (int c = 0; c < cols; c++) {
+                        for (int d = 0; d < 4; d++) {
+                                int end_r = r + (k - 1) * dirs[d][0];
+                                int end_c = c + (k - 1) * dirs[d][1];
+                                if (end_r >= rows || end_c < 0 ||
+                                    end_c >= cols) {
+                                        continue;
+                                }
+
+                                int16_t *w = &a->windows[a->num_windows * k];
+                                for (int i = 0; i < k; i++) {
+                                        w[i] = (r + i * dirs[d][0]) * cols +
+                                               c + i * dirs[d][1];
+                                }
+                                a->num_windows++;
+                        }
+                }
+        }
+}
+
+// counts the stones of each player in the lines still open to them; n stones
+// weigh n^2.
+static int
+evaluate(struct ab_t *a, enum player_t to_move, int k)
+{
+        const int8_t *cells = a->cells;
+        int           score = 0;  // for black.
+
+        for (int i = 0; i < a->num_windows; i++) {
+                const int16_t *w     = &a->windows[i * k];
+                int            black = 0;
+                int            white = 0;
+                for (int j = 0; j < k; j++) {
+                        black += cells[w[j]] > 0;
+                        white += cells[w[j]] < 0;
+                }
+                if (white == 0) score += black * black;
+                if (black == 0) score -= white * white;
+        }
+
+        if (score > EVAL_MAX) score = EVAL_MAX;
+        if (score < -EVAL_MAX) score = -EVAL_MAX;
+        return to_move == PLAYER_BLACK ? score : -score;
+}
+
+// evaluates through the cache, if any. entries hold the score for black and
+// are salted with the geometry, which the hash leaves out.
+static int
+evaluateCached(struct ab_t *a, enum player_t to_move)
+{
+        const struct board_t *b = a->scratch;
+        if (a->cache == NULL) return evaluate(a, to_move, b->num_to_win);
+
+        const uint64_t salt = EVCACHE_SALT_AB ^
+                              (uint64_t)b->num_to_win << 48 ^
+                              (uint64_t)b->rows << 32 ^ (uint64_t)b->cols << 16;
+        float v;
+        if (!evcacheGet(a->cache, b, salt, &v, /*policy=*/NULL)) {
+                v = evaluate(a, PLAYER_BLACK, b->num_to_win);
+                evcachePut(a->cache, b, salt, v, /*policy=*/NULL);
+        }
+        return to_move == PLAYER_BLACK ? (int)v : -(int)v;
+}
+
+static void
+historyAge(struct ab_t *a, int cells)
+{
+        for (int i = 0; i < 2 * cells; i++) a->history[i] /= 2;
+}
+
+// sorts the legal columns of the position, best first. returns their count.
+static int
+orderMoves(struct ab_t *a, enum player_t to_move, int ply, int tt_move,
+           _out_ int *moves)
+{
+        struct board_t *b    = a->scratch;
+        const int       cols = b->cols;
+        const uint32_t *hist = &a->history[PLAYER_INDEX(to_move) *
+                                           b->rows * cols];
+
+        uint64_t keys[cols];
+        int      n = 0;
+        for (int col = 0; col < cols; col++) {
+                int row = boardRowForCol(b, col);
+                if (row == -1) continue;
+
+                int      center = cols - abs(2 * col - (cols - 1));
+                uint64_t key    = (uint64_t)center * CENTER_WEIGHT;
+                if (col == tt_move) {
+                        key |= 1ULL << 40;
+                } else if (!a->opts.plain) {
+                        const int cell = row * cols + col;
+                        if (cell == a->killers[ply][0]) key += KILLER_BONUS;
+                        if (cell == a->killers[ply][1]) {
+                                key += KILLER_BONUS / 2;
+                        }
+                        key += hist[cell];
+                }
+
+                // insertion sort, descending.
+                int i = n++;
+                while (i > 0 && keys[i - 1] < key) {
+                        keys[i]  = keys[i - 1];
+                        moves[i] = moves[i - 1];
+                        i--;
+                }
+                keys[i]  = key;
+                moves[i] = col;
+        }
+        return n;
+}
+
+// records a quiet move causing a cutoff at 'ply'.
+static void
+updateOrdering(struct ab_t *a, enum player_t to_move, int ply, int depth,
+               int row, int col)
+{
+        const int cells = a->scratch->rows * a->scratch->cols;
+        const int cell  = row * a->scratch->cols + col;
+        if (a->killers[ply][0] != cell) {
+                a->killers[ply][1] = a->killers[ply][0];
+                a->killers[ply][0] = cell;
+        }
+
+        uint32_t *h = &a->history[PLAYER_INDEX(to_move) * cells + cell];
+        *h += depth * depth;
+        if (*h >= HISTORY_MAX) historyAge(a, cells);
+}
+
+static int
+negamax(struct ab_t *a, enum player_t to_move, int depth, int ply, int alpha,
+        int beta)
+{
+        struct board_t *b      = a->scratch;
+        const int       alpha0 = alpha;
+
+        a->nodes++;
+
+        uint64_t         hash    = boardHash(b);
+        int              tt_move = -1;
+        struct tt_data_t data;
+        if (a->tt != NULL && ttProbe(a->tt, hash, &data, &a->tt_stats)) {
+                if (data.move != TT_NO_MOVE) tt_move = data.move;
+
+                // the root needs a move, so it never returns early.
+                if (ply > 0 && data.depth >= depth) {
+                        if (data.flag == TT_FLAG_EXACT) return data.value;
+                        if (data.flag == TT_FLAG_LOWER && data.value > alpha) {
+                                alpha = data.value;
+                        }
+                        if (data.flag == TT_FLAG_UPPER && data.value < beta) {
+                                beta = data.value;
+                        }
+                        if (alpha >= beta) return data.value;
+                }
+        }
+
+        if (depth == 0) return evaluateCached(a, to_move);
+
+        int moves[b->cols];
+        int n = orderMoves(a, to_move, ply, tt_move, moves);
+
+        int best     = -INF_SCORE;
+        int best_col = TT_NO_MOVE;
+        for (int i = 0; i < n; i++) {
+                const int col = moves[i];
+                const int row = boardRowForCol(b, col);
+                const int v   = to_move == PLAYER_BLACK ? 1 : -1;
+
+                boardSet(b, row, col, to_move, 0);
+                a->cells[row * b->cols + col] = v;
+                a->empty--;
+
+                int           score;
+                enum player_t w = boardWinnerAt(b, row, col);
+                if (w == to_move) {
+                        score = TT_SCORE_WIN - 1;
+                } else if (w == PLAYER_TIE) {
+                        score = 0;
+                } else {
+                        score = -negamax(a, NEXT_PLAYER(to_move), depth - 1,
+                                         ply + 1, -beta, -alpha);
+                        // one ply further from the end.
+                        if (score > WIN_BOUND) score--;
+                        if (score < -WIN_BOUND) score++;
+                }
+
+                boardSet(b, row, col, PLAYER_NA, 0);
+                a->cells[row * b->cols + col] = 0;
+                a->empty++;
+
+                if (score > best) {
+                        best     = score;
+                        best_col = col;
+                }
+                if (score > alpha) alpha = score;
+                if (alpha >= beta) {
+                        a->cutoffs++;
+                        if (i == 0) a->first_cutoffs++;
+                        if (!a->opts.plain && w == PLAYER_NA) {
+                                updateOrdering(a, to_move, ply, depth, row,
+                                               col);
+                        }
+                        break;
+                }
+        }
+
+        if (ply == 0) a->best_col = best_col;
+
+        if (a->tt != NULL) {
+                struct tt_data_t store = {
+                    .value = best,
+                    .depth = depth,
+                    .flag  = best <= alpha0 ? TT_FLAG_UPPER
+                             : best >= beta ? TT_FLAG_LOWER
+                                            : TT_FLAG_EXACT,
+                    .move  = best_col,
+                };
+                // an exact win or loss holds at any depth.
+                if (store.flag == TT_FLAG_EXACT &&
+                    (best > WIN_BOUND || best < -WIN_BOUND)) {
+                        store.depth = TT_DEPTH_SOLVED;
+                }
+                ttStore(a->tt, hash, &store, &a->tt_stats);
+        }
+        return best;
+}
+
+// resets the scratch state for 'b' and ages the move ordering tables.
+static error_t
+searchReset(struct ab_t *a, struct board_t *b)
+{
+        if (b->cols >= TT_NO_MOVE) {
+                return errNew("too many columns for alpha-beta: %d", b->cols);
+        }
+
+        const int cells = b->rows * b->cols;
+        if (a->scratch == NULL || a->scratch->rows != b->rows ||
+            a->scratch->cols != b->cols ||
+            a->scratch->num_to_win != b->num_to_win) {
+                boardFree(a->scratch);
+                free(a->cells);
+                free(a->killers);
+                free(a->history);
+                a->scratch = boardClone(b);
+                a->cells   = malloc(cells * sizeof(*a->cells));
+                a->killers = malloc((cells + 1) * sizeof(*a->killers));
+                a->history = calloc(2 * cells, sizeof(*a->history));
+                windowsInit(a, b);
+        }
+
+        boardCopy(a->scratch, b);
+        a->empty = 0;
+        for (int r = 0; r < b->rows; r++) {
+                for (int c = 0; c < b->cols; c++) {
+                        int v;
+                        boardGet(b, r, c, &v);
+                        a->cells[r * b->cols + c] = v;
+                        a->empty += v == PLAYER_NA;
+                }
+        }
+
+        for (int i = 0; i <= cells; i++) {
+                a->killers[i][0] = -1;
+                a->killers[i][1] = -1;
+        }
+        historyAge(a, cells);
+        return OK;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+struct ab_t *
+abNew(const struct ab_opts_t *opts, struct tt_t *tt)
+{
+        struct ab_t *a = calloc(1, sizeof(*a));
+        a->opts        = *opts;
+        if (a->opts.depth <= 0) a->opts.depth = DEFAULT_DEPTH;
+        if (a->opts.depth >= TT_DEPTH_SOLVED) {
+                a->opts.depth = TT_DEPTH_SOLVED - 1;
+        }
+        a->tt = tt;
+        return a;
+}
+
+void
+abFree(struct ab_t *a)
+{
+        if (a == NULL) return;
+        boardFree(a->scratch);
+        free(a->cells);
+        free(a->windows);
+        free(a->killers);
+        free(a->history);
+        free(a);
+}
+
+error_t
+abSearch(struct ab_t *a, struct board_t *b, enum player_t next, int *col)
+{
+        if (boardWinner(b) != PLAYER_NA) return errNew("game is over.");
+
+        error_t err = searchReset(a, b);
+        if (err) return err;
+
+        if (a->tt != NULL) ttNewSearch(a->tt);
+
+        a->nodes         = 0;
+        a->cutoffs       = 0;
+        a->first_cutoffs = 0;
+        memset(&a->tt_stats, 0, sizeof(a->tt_stats));
+
+        TRACE_BEGIN(TRACE_SEARCH);
+
+        // deeper than the empty cells finds nothing new.
+        const int max_depth =
+            a->opts.depth < a->empty ? a->opts.depth : a->empty;
+        for (int depth = 1; depth <= max_depth; depth++) {
+                a->score = negamax(a, next, depth, 0, -INF_SCORE, INF_SCORE);
+                a->depth = depth;
+
+                // a proven result does not change with depth.
+                if (a->score > WIN_BOUND || a->score < -WIN_BOUND) break;
+        }
+
+        TRACE_END(TRACE_SEARCH);
+
+        *col = a->best_col;
+        return OK;
+}
+
+int
+abPV(struct ab_t *a, enum player_t next, uint8_t *pv, int max_len)
+{
+        if (a->scratch == NULL || max_len == 0) return 0;
+
+        struct board_t *b = a->scratch;  // the root position.
+        int             rows[max_len];
+        int             len = 0;
+
+        pv[len]   = a->best_col;
+        rows[len] = boardRowForCol(b, a->best_col);
+        while (rows[len] != -1) {
+                boardSet(b, rows[len], pv[len], next, 0);
+                enum player_t w = boardWinnerAt(b, rows[len], pv[len]);
+                next            = NEXT_PLAYER(next);
+                len++;
+
+                struct tt_data_t data;
+                if (w != PLAYER_NA || len == max_len || a->tt == NULL ||
+                    !ttProbe(a->tt, boardHash(b), &data, NULL) ||
+                    data.move >= b->cols) {
+                        break;
+                }
+                pv[len]   = data.move;
+                rows[len] = boardRowForCol(b, data.move);
+        }
+
+        for (int i = len - 1; i >= 0; i--) {
+                boardSet(b, rows[i], pv[i], PLAYER_NA, 0);
+        }
+        return len;
+}
@@ -0,0 +1,95 @@
+#ifndef BB_AB_H_
+#define BB_AB_H_
+
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+
+// bb
+#include "board.h"
+#include "evcache.h"
+#include "tt.h"
+
+// -----------------------------------------------------------------------------
+// Alpha-beta search.
+// -----------------------------------------------------------------------------
+//
+// Negamax with alpha-beta pruning and iterative deepening. The best move
+// stored in the transposition table is searched first; the other moves are
+// ordered by the sum of:
+//
+//   - a bonus for the two killer moves of the ply, i.e., the last cells
+//     played causing a cutoff at the same ply in a sibling subtree. Cells,
+//     not columns: the same column lands on another cell in most siblings;
+//   - the history score of the (player, cell) pair, bumped by depth^2 on
+//     every cutoff;
+//   - a weight per column step toward the center.
+//
+// The killers and history only break the center order once they are strong
+// enough: ranking them strictly first costs nodes when the table already
+// supplies the best move of most nodes. History scores are halved before each
+// search, so older games fade out.
+//
+// Scores are for the side to move. A win in n plies scores TT_SCORE_WIN - n;
+// otherwise, the evaluation counts the lines still open to each player.
+//
+// With a cache, evaluations at the horizon are looked up before being
+// computed. The score for black does not change when the board is mirrored,
+// so mirrored positions share an entry. A lookup costs two hashes, so it only
+// pays off on boards with many lines, e.g., 9x12 or larger.
+
+struct ab_opts_t {
+        int depth;  // max depth of the iterative deepening.
+        int plain;  // 1 to disable killers and history, for comparison.
+};
+
+struct ab_t {
+        struct ab_opts_t opts;
+
+        struct tt_t      *tt;       // unowned. NULL-able.
+        struct evcache_t *cache;    // unowned. NULL-able.
+        struct board_t   *scratch;  // owned. NULL before first search.
+
+        int8_t  *cells;        // owned. +1 black, -1 white, 0 empty.
+        int16_t *windows;      // owned. num_to_win cells per line.
+        int      num_windows;  // lines of num_to_win cells on the board.
+        int      empty;        // empty cells of scratch.
+
+        int     (*killers)[2];  // owned. two cells per ply. -1 if unset.
+        uint32_t *history;      // owned. [player][cell]. black first.
+
+        int best_col;  // root move of the last completed iteration.
+
+        // stats of the last search.
+        int      depth;          // last completed depth.
+        int      score;          // score at that depth.
+        uint64_t nodes;          // nodes searched.
+        uint64_t cutoffs;        // beta cutoffs.
+        uint64_t first_cutoffs;  // beta cutoffs by the first move searched.
+
+        struct tt_stats_t tt_stats;  // table probes and stores.
+};
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+extern struct ab_t *abNew(const struct ab_opts_t *opts, struct tt_t *tt);
+extern void         abFree(struct ab_t *a);
+
+// Searches the position 'b', with 'next' to play, and returns the best column
+// in 'col'.
+//
+// The ratio first_cutoffs / cutoffs is the share of cutoffs by the first move,
+// i.e., how good the move ordering is. It is close to 1 when ordering works.
+extern error_t abSearch(struct ab_t *a, struct board_t *b, enum player_t next,
+                        _out_ int *col);
+
+// Fills 'pv' with the principal variation of the last search, following the
+// best moves stored in the table, up to 'max_len' columns. 'next' must be the
+// player to move of that search. Returns the count.
+extern int abPV(struct ab_t *a, enum player_t next, _out_ uint8_t *pv,
+                int max_len);
+
+#endif  // BB_AB_H_
@@ -0,0 +1,228 @@
+#ifndef BB_BITSET_H_
+#define BB_BITSET_H_
+
+#include <stdint.h>  // uint64_t
+#include <string.h>  // memcpy
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Multi-word bitsets.
+// -----------------------------------------------------------------------------
+//
+// A bitset is a plain array of 64-bit words, with bit i stored in word i/64.
+// Word counts are 1, 2, 4 or 8 (64 to 512 bits), so the hot loops have small
+// constant trip counts and the 128/256/512-bit cases map onto SSE2 and AVX2
+// registers.
+//
+// All helpers are static inline as they sit on the hot path of the board.
+
+#define BITSET_MAX_WORDS 8
+#define BITSET_MAX_BITS  (64 * BITSET_MAX_WORDS)
+
+// Returns the word count (1, 2, 4 or 8) to hold `bits`; 0 if too large.
+static inline int
+bitsetWordsFor(int bits)
+{
+        int words = 1;
+        while (words * 64 < bits) words *= 2;
+        return words <= BITSET_MAX_WORDS ? words : 0;
+}
+
+static inline int
+bitsetTest(const uint64_t *s, int pos)
+{
+        return (s[pos >> 6] >> (pos & 63)) & 1;
+}
+
+static inline void
+bitsetSet(uint64_t *s, int pos)
+{
+        s[pos >> 6] |= (uint64_t)1 << (pos & 63);
+}
+
+static inline void
+bitsetClear(uint64_t *s, int pos)
+{
+        s[pos >> 6] &= ~((uint64_t)1 << (pos & 63));
+}
+
+static inline int
+bitsetIsZero(const uint64_t *s, int words)
+{
+        uint64_t acc = 0;
+        for (int i = 0; i < words; i++) acc |= s[i];
+        return acc == 0;
+}
+
+static inline int
+bitsetPopcount(const uint64_t *s, int words)
+{
+        int count = 0;
+        for (int i = 0; i < words; i++) count += __builtin_popcountll(s[i]);
+        return count;
+}
+
+// Returns `len` (< 64) bits starting at `pos`, which may straddle two words.
+static inline uint64_t
+bitsetExtract(const uint64_t *s, int words, int pos, int len)
+{
+        const int w   = pos >> 6;
+        const int off = pos & 63;
+
+        uint64_t v = s[w] >> off;
+        if (off + len > 64 && w + 1 < words) {
+                v |= s[w + 1] << (64 - off);
+        }
+        return v & (((uint64_t)1 << len) - 1);
+}
+
+// dst = src >> n. dst must not alias src.
+static inline void
+bitsetShr(uint64_t *dst, const uint64_t *src, int words, int n)
+{
+        const int q = n >> 6;
+        const int r = n & 63;
+
+        for (int i = 0; i < words; i++) {
+                uint64_t lo = i + q < words ? src[i + q] : 0;
+                uint64_t hi = i + q + 1 < words ? src[i + q + 1] : 0;
+                dst[i]      = r == 0 ? lo : (lo >> r) | (hi << (64 - r));
+        }
+}
+
+// -----------------------------------------------------------------------------
+// Run detection.
+// -----------------------------------------------------------------------------
+//
+// Returns non-zero if `s` has `k` set bits spaced by `d`, i.e., bits i, i+d,
+// ..., i+(k-1)d are all set for some i.
+//
+// The recurrence is t_1 = s, t_{j+1} = s & (t_j >> d); bit i of t_j is set iff
+// the run of length j starts at i. Only shifts by `d` are needed, so the
+// vector kernels just carry d bits across lanes.
+
+static inline int
+_bitsetHasRunGeneric(const uint64_t *s, int words, int d, int k)
+{
+        uint64_t t[BITSET_MAX_WORDS];
+        uint64_t u[BITSET_MAX_WORDS];
+
+        memcpy(t, s, words * sizeof(uint64_t));
+        for (int j = 1; j < k; j++) {
+                bitsetShr(u, t, words, d);
+                for (int i = 0; i < words; i++) t[i] = s[i] & u[i];
+        }
+        return !bitsetIsZero(t, words);
+}
+
+static inline int
+_bitsetHasRun64(uint64_t s, int d, int k)
+{
+        uint64_t t = s;
+        for (int j = 1; j < k; j++) t = s & (t >> d);
+        return t != 0;
+}
+
+#if defined(__SSE2__)
+static inline int
+_bitsetHasRun128(const uint64_t *src, int d, int k)
+{
+        const __m128i s  = _mm_loadu_si128((const __m128i *)src);
+        const __m128i cr = _mm_cvtsi32_si128(d);
+        const __m128i cl = _mm_cvtsi32_si128(64 - d);
+
+        __m128i t = s;
+        for (int j = 1; j < k; j++) {
+                // the upper lane moves down to carry bits across the lanes.
+                __m128i nx = _mm_srli_si128(t, 8);
+                __m128i sh = _mm_or_si128(_mm_srl_epi64(t, cr),
+                                          _mm_sll_epi64(nx, cl));
+                t          = _mm_and_si128(s, sh);
+        }
+        uint64_t lo = _mm_cvtsi128_si64(t);
+        uint64_t hi = _mm_cvtsi128_si64(_mm_srli_si128(t, 8));
+        return (lo | hi) != 0;
+}
+#endif
+
+#if defined(__AVX2__)
+static inline int
+_bitsetHasRun256(const uint64_t *src, int d, int k)
+{
+        const __m256i s    = _mm256_loadu_si256((const __m256i *)src);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m128i cr   = _mm_cvtsi32_si128(d);
+        const __m128i cl   = _mm_cvtsi32_si128(64 - d);
+
+        __m256i t = s;
+        for (int j = 1; j < k; j++) {
+                // nx = [t1, t2, t3, 0], i.e., the next word of each lane.
+                __m256i nx =
+                    _mm256_permute4x64_epi64(t, _MM_SHUFFLE(3, 3, 2, 1));
+                nx = _mm256_blend_epi32(nx, zero, 0xC0);
+                t  = _mm256_and_si256(
+                    s, _mm256_or_si256(_mm256_srl_epi64(t, cr),
+                                       _mm256_sll_epi64(nx, cl)));
+        }
+        return !_mm256_testz_si256(t, t);
+}
+
+static inline int
+_bitsetHasRun512(const uint64_t *src, int d, int k)
+{
+        const __m256i s_lo = _mm256_loadu_si256((const __m256i *)src);
+        const __m256i s_hi = _mm256_loadu_si256((const __m256i *)(src + 4));
+        const __m256i zero = _mm256_setzero_si256();
+        const __m128i cr   = _mm_cvtsi32_si128(d);
+        const __m128i cl   = _mm_cvtsi32_si128(64 - d);
+
+        __m256i t_lo = s_lo;
+        __m256i t_hi = s_hi;
+        for (int j = 1; j < k; j++) {
+                // nx_lo = [lo1, lo2, lo3, hi0]; nx_hi = [hi1, hi2, hi3, 0].
+                __m256i nx_lo =
+                    _mm256_permute4x64_epi64(t_lo, _MM_SHUFFLE(3, 3, 2, 1));
+                __m256i hi0 =
+                    _mm256_permute4x64_epi64(t_hi, _MM_SHUFFLE(0, 0, 0, 0));
+                nx_lo = _mm256_blend_epi32(nx_lo, hi0, 0xC0);
+
+                __m256i nx_hi =
+                    _mm256_permute4x64_epi64(t_hi, _MM_SHUFFLE(3, 3, 2, 1));
+                nx_hi = _mm256_blend_epi32(nx_hi, zero, 0xC0);
+
+                t_lo = _mm256_and_si256(
+                    s_lo, _mm256_or_si256(_mm256_srl_epi64(t_lo, cr),
+                                          _mm256_sll_epi64(nx_lo, cl)));
+                t_hi = _mm256_and_si256(
+                    s_hi, _mm256_or_si256(_mm256_srl_epi64(t_hi, cr),
+                                          _mm256_sll_epi64(nx_hi, cl)));
+        }
+        __m256i t = _mm256_or_si256(t_lo, t_hi);
+        return !_mm256_testz_si256(t, t);
+}
+#endif
+
+static inline int
+bitsetHasRun(const uint64_t *s, int words, int d, int k)
+{
+        if (k > 1 && d >= 64 * words) return 0;  // no room for a second bit.
+
+        if (words == 1) return _bitsetHasRun64(s[0], d, k);
+
+        // the vector kernels carry at most one word across lanes.
+        if (d < 64) {
+#if defined(__SSE2__)
+                if (words == 2) return _bitsetHasRun128(s, d, k);
+#endif
+#if defined(__AVX2__)
+                if (words == 4) return _bitsetHasRun256(s, d, k);
+                if (words == 8) return _bitsetHasRun512(s, d, k);
+#endif
+        }
+        return _bitsetHasRunGeneric(s, words, d, k);
+}
+
+#endif  // BB_BITSET_H_
@@ -2,6 +2,30 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>  // memcpy
+
+// eva
+#include <rng/srng64.h>
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+// bit position of (row, col) in the bitsets. row 0 is the top row.
+#define BIT_POS(b, row, col) ((col) * (b)->height + ((b)->rows - 1 - (row)))
+
+// bytes allocated for a board, including states[] if any.
+#define BOARD_SIZE(b)                     \
+        (sizeof(struct board_t) +         \
+         ((b)->words == 0 ? (size_t)(b)->rows * (b)->cols * sizeof(int) : 0))
+
+static const struct board_ops_t ops_bitsets;
+static const struct board_ops_t ops_states;
+static const struct board_ops_t *kernelOps(int rows, int cols, int num_to_win);
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
 
 struct board_t *
 boardNew(int rows, int cols, int num_to_win, int mode)
@@ -9,11 +33,28 @@ boardNew(int rows, int cols, int num_to_win, int mode)
         size_t c = rows * cols;
         assert(c > 0);
 
-        struct board_t *p = calloc(1, sizeof(struct board_t) + c * sizeof(int));
-        p->rows           = rows;
-        p->cols           = cols;
-        p->num_to_win     = num_to_win;
-        p->mode           = mode;
+        // the column extraction in rowForColBitsets needs rows < 64.
+        const int height = rows + 1;
+        const int words =
+            height <= 64 ? bitsetWordsFor(cols * height) : /*too tall=*/0;
+
+        struct board_t *p = calloc(
+            1, sizeof(struct board_t) + (words == 0 ? c * sizeof(int) : 0));
+        p->rows       = rows;
+        p->cols       = cols;
+        p->num_to_win = num_to_win;
+        p->mode       = mode;
+        p->words      = words;
+        p->height     = height;
+
+        if (words == 0) {
+                p->ops = &ops_states;
+        } else {
+                // the specialized kernels assume stones stacked by gravity.
+                const struct board_ops_t *ops =
+                    mode == 1 ? kernelOps(rows, cols, num_to_win) : NULL;
+                p->ops = ops != NULL ? ops : &ops_bitsets;
+        }
 
         return p;
 }
@@ -24,19 +65,151 @@ boardFree(struct board_t *p)
         free(p);
 }
 
+void
+boardUseGenericOps(struct board_t *b)
+{
+        b->ops = b->words == 0 ? &ops_states : &ops_bitsets;
+}
+
+struct board_t *
+boardClone(const struct board_t *b)
+{
+        struct board_t *p = malloc(BOARD_SIZE(b));
+        memcpy(p, b, BOARD_SIZE(b));
+        return p;
+}
+
+void
+boardCopy(struct board_t *dst, const struct board_t *src)
+{
+        assert(dst->rows == src->rows && dst->cols == src->cols);
+        memcpy(dst, src, BOARD_SIZE(src));
+}
+
+// splitmix64 finalizer.
+static inline uint64_t
+mix64(uint64_t z)
+{
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+}
+
+// hashes the stones of the bitsets backend.
+static uint64_t
+hashBitsets(const uint64_t *black, const uint64_t *white, int words)
+{
+        uint64_t h = 0x9e3779b97f4a7c15ULL;
+        for (int i = 0; i < words; i++) {
+                h = mix64(h ^ black[i]);
+                h = mix64(h ^ white[i]);
+        }
+        return h;
+}
+
+// hashes the states[] backend, with the columns reversed if 'mirror'.
+static uint64_t
+hashStates(const struct board_t *b, int mirror)
+{
+        uint64_t h = 0x9e3779b97f4a7c15ULL;
+
+        // pack 32 cells of 2 bits into each word before mixing.
+        const int n = b->rows * b->cols;
+        uint64_t  w = 0;
+        for (int i = 0; i < n; i++) {
+                const int c    = i % b->cols;
+                const int cell = mirror ? i - c + b->cols - 1 - c : i;
+                w = (w << 2) | (uint64_t)(b->states[cell] & 3);
+                if (i % 32 == 31 || i == n - 1) {
+                        h = mix64(h ^ w);
+                        w = 0;
+                }
+        }
+        return h;
+}
+
+uint64_t
+boardHash(const struct board_t *b)
+{
+        if (b->words != 0) {
+                return hashBitsets(b->stones[0], b->stones[1], b->words);
+        }
+        return hashStates(b, /*mirror=*/0);
+}
+
+uint64_t
+boardHashMirror(const struct board_t *b)
+{
+        if (b->words == 0) return hashStates(b, /*mirror=*/1);
+
+        const int rows  = b->rows;
+        const int words = b->words;
+
+        uint64_t m[2][BOARD_MAX_WORDS] = {{0}};
+        for (int c = 0; c < b->cols; c++) {
+                const int src = c * b->height;
+                const int dst = (b->cols - 1 - c) * b->height;
+                for (int p = 0; p < 2; p++) {
+                        if (rows >= 64) {
+                                for (int i = 0; i < rows; i++) {
+                                        if (bitsetTest(b->stones[p], src + i)) {
+                                                bitsetSet(m[p], dst + i);
+                                        }
+                                }
+                                continue;
+                        }
+
+                        // the column may straddle two words at both ends.
+                        const uint64_t v =
+                            bitsetExtract(b->stones[p], words, src, rows);
+                        const int w   = dst >> 6;
+                        const int off = dst & 63;
+                        m[p][w] |= v << off;
+                        if (off + rows > 64) m[p][w + 1] |= v >> (64 - off);
+                }
+        }
+        return hashBitsets(m[0], m[1], words);
+}
+
+size_t
+boardSnapshotSize(const struct board_t *b)
+{
+        return 2 * b->words * sizeof(uint64_t);
+}
+
+error_t
+boardSnapshot(const struct board_t *b, void *buf)
+{
+        if (b->words == 0) {
+                return errNew("board is too large for snapshot: %dx%d",
+                              b->rows, b->cols);
+        }
+
+        const size_t bytes = b->words * sizeof(uint64_t);
+        memcpy(buf, b->stones[0], bytes);
+        memcpy((uint8_t *)buf + bytes, b->stones[1], bytes);
+        return OK;
+}
+
+error_t
+boardRestore(struct board_t *b, const void *buf)
+{
+        if (b->words == 0) {
+                return errNew("board is too large for snapshot: %dx%d",
+                              b->rows, b->cols);
+        }
+
+        const size_t bytes = b->words * sizeof(uint64_t);
+        memcpy(b->stones[0], buf, bytes);
+        memcpy(b->stones[1], (const uint8_t *)buf + bytes, bytes);
+        return OK;
+}
+
 // find the row to put the col or -1 if the col is full.
 int
 boardRowForCol(struct board_t *b, int col)
 {
-        // find the first bottom row which is not filled yet.
-        const int num_col = b->cols;
-        for (int r = b->rows - 1; r >= 0; r--) {
-                size_t offset = r * num_col + col;
-                if (b->states[offset] == PLAYER_NA) {
-                        return r;
-                }
-        }
-        return -1;
+        return b->ops->row_for_col(b, col);
 }
 
 // put a new value into the board.
@@ -47,6 +220,15 @@ boardSet(struct board_t *b, int row, int col, int v, int flag)
 {
         // unsupported yet.
         assert(flag == 0);
+        assert(v == PLAYER_NA || v == PLAYER_BLACK || v == PLAYER_WHITE);
+
+        if (b->words != 0) {
+                const int pos = BIT_POS(b, row, col);
+                bitsetClear(b->stones[0], pos);
+                bitsetClear(b->stones[1], pos);
+                if (v != PLAYER_NA) bitsetSet(b->stones[PLAYER_INDEX(v)], pos);
+                return OK;
+        }
 
         size_t offset     = row * b->cols + col;
         b->states[offset] = v;
@@ -57,6 +239,14 @@ boardSet(struct board_t *b, int row, int col, int v, int flag)
 error_t
 boardGet(struct board_t *p, int row, int col, int *v)
 {
+        if (p->words != 0) {
+                const int pos = BIT_POS(p, row, col);
+                *v            = bitsetTest(p->stones[0], pos)   ? PLAYER_BLACK
+                                : bitsetTest(p->stones[1], pos) ? PLAYER_WHITE
+                                                                : PLAYER_NA;
+                return OK;
+        }
+
         size_t offset = row * p->cols + col;
         *v            = p->states[offset];
         return OK;
@@ -64,6 +254,138 @@ boardGet(struct board_t *p, int row, int col, int *v)
 
 enum player_t
 boardWinner(struct board_t *b)
+{
+        return b->ops->winner(b);
+}
+
+enum player_t
+boardWinnerAt(struct board_t *b, int row, int col)
+{
+        return b->ops->winner_at(b, row, col);
+}
+
+enum player_t
+boardPlayout(struct board_t *b, enum player_t next, struct rng64_t *rng,
+             uint8_t *moves, int *num_moves)
+{
+        return b->ops->playout(b, next, rng, moves, num_moves);
+}
+
+// -----------------------------------------------------------------------------
+// bitsets backend.
+// -----------------------------------------------------------------------------
+
+static int
+rowForColBitsets(struct board_t *b, int col)
+{
+        // the lowest clear bit of the column is the first bottom row which is
+        // not filled yet.
+        const int pos   = BIT_POS(b, b->rows - 1, col);
+        const int words = b->words;
+        uint64_t  occupied = bitsetExtract(b->stones[0], words, pos, b->rows) |
+                            bitsetExtract(b->stones[1], words, pos, b->rows);
+
+        int h = __builtin_ctzll(~occupied);
+        return h < b->rows ? b->rows - 1 - h : -1;
+}
+
+// A line of `num_to_win` stones is a run of bits spaced by 1 (vertical),
+// height (horizontal), height - 1 and height + 1 (diagonals).
+static int
+hasLineBitsets(struct board_t *b, const uint64_t *s)
+{
+        const int words      = b->words;
+        const int h          = b->height;
+        const int num_to_win = b->num_to_win;
+
+        return bitsetHasRun(s, words, 1, num_to_win) ||
+               bitsetHasRun(s, words, h, num_to_win) ||
+               bitsetHasRun(s, words, h - 1, num_to_win) ||
+               bitsetHasRun(s, words, h + 1, num_to_win);
+}
+
+static enum player_t
+tieOrNoneBitsets(struct board_t *b)
+{
+        const int words      = b->words;
+        int       num_stones = bitsetPopcount(b->stones[0], words) +
+                         bitsetPopcount(b->stones[1], words);
+        return num_stones == b->rows * b->cols ? PLAYER_TIE : PLAYER_NA;
+}
+
+static enum player_t
+winnerBitsets(struct board_t *b)
+{
+        if (hasLineBitsets(b, b->stones[0])) return PLAYER_BLACK;
+        if (hasLineBitsets(b, b->stones[1])) return PLAYER_WHITE;
+        return tieOrNoneBitsets(b);
+}
+
+// only the player owning (row, col) can have completed a line with it.
+static enum player_t
+winnerAtBitsets(struct board_t *b, int row, int col)
+{
+        int v;
+        boardGet(b, row, col, &v);
+        assert(v != PLAYER_NA);
+
+        if (hasLineBitsets(b, b->stones[PLAYER_INDEX(v)])) return v;
+        return tieOrNoneBitsets(b);
+}
+
+// -----------------------------------------------------------------------------
+// states backend.
+// -----------------------------------------------------------------------------
+
+static int
+rowForColStates(struct board_t *b, int col)
+{
+        // find the first bottom row which is not filled yet.
+        const int num_col = b->cols;
+        for (int r = b->rows - 1; r >= 0; r--) {
+                size_t offset = r * num_col + col;
+                if (b->states[offset] == PLAYER_NA) {
+                        return r;
+                }
+        }
+        return -1;
+}
+
+static enum player_t
+winnerAtStates(struct board_t *b, int row, int col)
+{
+        const int rows       = b->rows;
+        const int cols       = b->cols;
+        const int num_to_win = b->num_to_win;
+        const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+
+        const int v = b->states[row * cols + col];
+        assert(v != PLAYER_NA);
+
+        // count the stones of `v` on both sides of (row, col) per direction.
+        for (int i = 0; i < 4; i++) {
+                int count = 1;
+                for (int sign = -1; sign <= 1; sign += 2) {
+                        int r = row + sign * dirs[i][0];
+                        int c = col + sign * dirs[i][1];
+                        while (r >= 0 && r < rows && c >= 0 && c < cols &&
+                               b->states[r * cols + c] == v) {
+                                count++;
+                                r += sign * dirs[i][0];
+                                c += sign * dirs[i][1];
+                        }
+                }
+                if (count >= num_to_win) return v;
+        }
+
+        for (int i = 0; i < rows * cols; i++) {
+                if (b->states[i] == PLAYER_NA) return PLAYER_NA;
+        }
+        return PLAYER_TIE;
+}
+
+static enum player_t
+winnerStates(struct board_t *b)
 {
         const int rows       = b->rows;
         const int cols       = b->cols;
@@ -183,3 +505,221 @@ boardWinner(struct board_t *b)
 
         return num_stones == rows * cols ? PLAYER_TIE : PLAYER_NA;
 }
+
+// -----------------------------------------------------------------------------
+// generic playout.
+// -----------------------------------------------------------------------------
+
+// plays random columns, via rejection sampling, until the game ends.
+static enum player_t
+playoutGeneric(struct board_t *b, enum player_t next, struct rng64_t *rng,
+               uint8_t *moves, int *num_moves)
+{
+        const int cols  = b->cols;
+        enum player_t w = boardWinner(b);
+        int           row, col;
+        int           n = 0;
+
+        while (w == PLAYER_NA) {
+                do {
+                        col = rng64NextUint64(rng) % cols;
+                        row = boardRowForCol(b, col);
+                } while (row == -1);
+
+                boardSet(b, row, col, next, 0);
+                w    = boardWinnerAt(b, row, col);
+                next = NEXT_PLAYER(next);
+                if (moves != NULL) moves[n++] = col;
+        }
+        if (moves != NULL) *num_moves = n;
+        return w;
+}
+
+static const struct board_ops_t ops_bitsets = {
+    .row_for_col = rowForColBitsets,
+    .winner      = winnerBitsets,
+    .winner_at   = winnerAtBitsets,
+    .playout     = playoutGeneric,
+};
+
+static const struct board_ops_t ops_states = {
+    .row_for_col = rowForColStates,
+    .winner      = winnerStates,
+    .winner_at   = winnerAtStates,
+    .playout     = playoutGeneric,
+};
+
+// -----------------------------------------------------------------------------
+// specialized kernels.
+// -----------------------------------------------------------------------------
+//
+// The common geometries fit in one word. The kernels below are instantiated
+// with rows, cols and num_to_win as compile-time constants, so the loops are
+// fully unrolled and all shifts and masks are folded into immediates.
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+// bit i of the result is set iff bits i, i+d, ..., i+(k-1)d are set in s.
+// doubling the run length needs only log2(k) shifts.
+ALWAYS_INLINE uint64_t
+runs64(uint64_t s, const int d, const int k)
+{
+        int len = 1;
+        while (2 * len <= k) {
+                s &= s >> (len * d);
+                len *= 2;
+        }
+        if (len < k) s &= s >> ((k - len) * d);
+        return s;
+}
+
+ALWAYS_INLINE int
+hasLine64(uint64_t s, const int h, const int k)
+{
+        return (runs64(s, 1, k) | runs64(s, h, k) | runs64(s, h - 1, k) |
+                runs64(s, h + 1, k)) != 0;
+}
+
+// the bits of the bottom row, one per column.
+ALWAYS_INLINE uint64_t
+bottomMask64(const int cols, const int h)
+{
+        uint64_t m = 0;
+        for (int c = 0; c < cols; c++) m |= (uint64_t)1 << (c * h);
+        return m;
+}
+
+ALWAYS_INLINE int
+rowForCol64(struct board_t *b, int col, const int rows)
+{
+        const int h        = rows + 1;
+        uint64_t  occupied = (b->stones[0][0] | b->stones[1][0]) >> (col * h);
+
+        int lowest = __builtin_ctzll(~occupied);
+        return lowest < rows ? rows - 1 - lowest : -1;
+}
+
+ALWAYS_INLINE enum player_t
+tieOrNone64(struct board_t *b, const int rows, const int cols)
+{
+        uint64_t occupied = b->stones[0][0] | b->stones[1][0];
+        return __builtin_popcountll(occupied) == rows * cols ? PLAYER_TIE
+                                                              : PLAYER_NA;
+}
+
+ALWAYS_INLINE enum player_t
+winner64(struct board_t *b, const int rows, const int cols, const int k)
+{
+        const int h = rows + 1;
+        if (hasLine64(b->stones[0][0], h, k)) return PLAYER_BLACK;
+        if (hasLine64(b->stones[1][0], h, k)) return PLAYER_WHITE;
+        return tieOrNone64(b, rows, cols);
+}
+
+ALWAYS_INLINE enum player_t
+winnerAt64(struct board_t *b, int row, int col, const int rows,
+           const int cols, const int k)
+{
+        const int h   = rows + 1;
+        const int pos = col * h + (rows - 1 - row);
+        const int i   = (b->stones[0][0] >> pos) & 1 ? 0 : 1;
+        assert((b->stones[i][0] >> pos) & 1);
+
+        if (hasLine64(b->stones[i][0], h, k)) {
+                return i == 0 ? PLAYER_BLACK : PLAYER_WHITE;
+        }
+        return tieOrNone64(b, rows, cols);
+}
+
+// keeps both players in registers and drops a stone with the carry trick:
+// adding the bottom bit of a column to the occupied mask carries into the
+// first empty cell of that column.
+ALWAYS_INLINE enum player_t
+playout64(struct board_t *b, enum player_t next, struct rng64_t *rng,
+          uint8_t *moves, int *num_moves, const int rows, const int cols,
+          const int k)
+{
+        const int      h      = rows + 1;
+        const uint64_t bottom = bottomMask64(cols, h);
+        const uint64_t full   = bottom * (((uint64_t)1 << rows) - 1);
+
+        uint64_t s[2]     = {b->stones[0][0], b->stones[1][0]};
+        uint64_t occupied = s[0] | s[1];
+        int      i        = PLAYER_INDEX(next);
+
+        enum player_t w = winner64(b, rows, cols, k);
+        int           n = 0;
+
+        while (w == PLAYER_NA) {
+                int col;
+                do {
+                        col = rng64NextUint64(rng) % cols;
+                } while ((occupied >> (col * h + rows - 1)) & 1);
+
+                const uint64_t col_mask = (((uint64_t)1 << rows) - 1)
+                                          << (col * h);
+                const uint64_t move =
+                    (occupied + ((uint64_t)1 << (col * h))) & col_mask;
+
+                s[i] |= move;
+                occupied |= move;
+                if (moves != NULL) moves[n++] = col;
+
+                if (hasLine64(s[i], h, k)) {
+                        w = i == 0 ? PLAYER_BLACK : PLAYER_WHITE;
+                } else if (occupied == full) {
+                        w = PLAYER_TIE;
+                }
+                i ^= 1;
+        }
+
+        b->stones[0][0] = s[0];
+        b->stones[1][0] = s[1];
+        if (moves != NULL) *num_moves = n;
+        return w;
+}
+
+#define DEFINE_KERNEL(R, C, K)                                                \
+        static int rowForCol_##R##x##C##x##K(struct board_t *b, int col)       \
+        {                                                                      \
+                return rowForCol64(b, col, R);                                 \
+        }                                                                      \
+        static enum player_t winner_##R##x##C##x##K(struct board_t *b)         \
+        {                                                                      \
+                return winner64(b, R, C, K);                                   \
+        }                                                                      \
+        static enum player_t winnerAt_##R##x##C##x##K(struct board_t *b,       \
+                                                      int row, int col)        \
+        {                                                                      \
+                return winnerAt64(b, row, col, R, C, K);                       \
+        }                                                                      \
+        static enum player_t playout_##R##x##C##x##K(                          \
+            struct board_t *b, enum player_t next, struct rng64_t *rng,        \
+            uint8_t *moves, int *num_moves)                                    \
+        {                                                                      \
+                return playout64(b, next, rng, moves, num_moves, R, C, K);     \
+        }                                                                      \
+        static const struct board_ops_t ops_##R##x##C##x##K = {                \
+            .row_for_col = rowForCol_##R##x##C##x##K,                          \
+            .winner      = winner_##R##x##C##x##K,                             \
+            .winner_at   = winnerAt_##R##x##C##x##K,                           \
+            .playout     = playout_##R##x##C##x##K,                            \
+        };
+
+DEFINE_KERNEL(6, 7, 4)  // connect 4.
+DEFINE_KERNEL(4, 5, 3)  // small board for testing.
+DEFINE_KERNEL(7, 8, 4)  // 64 bits with the sentinel row.
+
+#undef DEFINE_KERNEL
+#undef ALWAYS_INLINE
+
+static const struct board_ops_t *
+kernelOps(int rows, int cols, int num_to_win)
+{
+#define MATCH(R, C, K) (rows == (R) && cols == (C) && num_to_win == (K))
+        if (MATCH(6, 7, 4)) return &ops_6x7x4;
+        if (MATCH(4, 5, 3)) return &ops_4x5x3;
+        if (MATCH(7, 8, 4)) return &ops_7x8x4;
+#undef MATCH
+        return NULL;
+}
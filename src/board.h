@@ -1,9 +1,15 @@
 #ifndef BB_BOARD_H_
 #define BB_BOARD_H_
 
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t
+
 // eva
 #include <base/error.h>
 
+// bb
+#include "bitset.h"
+
 // -----------------------------------------------------------------------------
 // Board and Player Data structures.
 // -----------------------------------------------------------------------------
@@ -15,6 +21,34 @@ enum player_t {
         PLAYER_TIE   = 999,  // only used to decide winner.
 };
 
+#define NEXT_PLAYER(v) ((v) == PLAYER_BLACK ? PLAYER_WHITE : PLAYER_BLACK)
+
+// index of the bitset or table row of a player: 0 black, 1 white.
+#define PLAYER_INDEX(v) ((v) == PLAYER_BLACK ? 0 : 1)
+
+// Boards are backed by one bitset per player when they fit (see
+// BOARD_MAX_BITS). Cells are laid out column by column and each column owns
+// `rows + 1` bits, bottom row first. The extra sentinel bit is never set, so
+// the shift-based line detection cannot wrap from one column into the next.
+//
+// Larger boards fall back to the per-cell `states[]` array.
+#define BOARD_MAX_WORDS BITSET_MAX_WORDS
+#define BOARD_MAX_BITS  BITSET_MAX_BITS
+
+struct board_t;
+struct rng64_t;
+
+// Hot-path routines of a board. boardNew picks the kernels specialized for the
+// board geometry, falling back to the generic bitsets or states[] ones.
+struct board_ops_t {
+        int (*row_for_col)(struct board_t *, int col);
+        enum player_t (*winner)(struct board_t *);
+        enum player_t (*winner_at)(struct board_t *, int row, int col);
+        enum player_t (*playout)(struct board_t *, enum player_t next,
+                                 struct rng64_t *, uint8_t *moves,
+                                 int *num_moves);
+};
+
 struct board_t {
         // public
         int rows;
@@ -23,7 +57,12 @@ struct board_t {
         int mode;  // OR-ed value of 1 (select col) 2 (select row)
 
         // internal
-        int states[];
+        const struct board_ops_t *ops;  // unowned.
+
+        int      words;   // words per bitset. 0 means states[] backend.
+        int      height;  // bits per column in the bitsets, i.e., rows + 1.
+        uint64_t stones[2][BOARD_MAX_WORDS];  // [0] black, [1] white.
+        int      states[];                    // allocated for states[] only.
 };
 
 // -----------------------------------------------------------------------------
@@ -32,6 +71,34 @@ struct board_t {
 extern struct board_t *boardNew(int rows, int cols, int num_to_win, int mode);
 extern void            boardFree(struct board_t *p);
 
+// Switches 'b' from the kernels specialized for its geometry to the generic
+// ones of its backend, e.g., to check or time the specialized ones. Clones
+// and copies of 'b' keep the generic ones.
+extern void boardUseGenericOps(struct board_t *b);
+
+// Clones 'b' into a new board, or copies 'src' into 'dst' without allocation.
+// For boardCopy, both boards must have the same geometry.
+extern struct board_t *boardClone(const struct board_t *b);
+extern void boardCopy(struct board_t *dst, const struct board_t *src);
+
+// Returns a 64-bit hash of the stones. The side to move follows from the stone
+// counts, so equal hashes identify transpositions, modulo collisions.
+extern uint64_t boardHash(const struct board_t *b);
+
+// Returns the hash of 'b' mirrored left to right, i.e., boardHash of the board
+// with column c moved to cols - 1 - c, without building it.
+extern uint64_t boardHashMirror(const struct board_t *b);
+
+// Returns the bytes of a snapshot of 'b': its b->words words per player, black
+// first, e.g., 16 bytes on 6x7. 0 if 'b' has no bitsets to snapshot.
+extern size_t boardSnapshotSize(const struct board_t *b);
+
+// Converts between boards and snapshots, i.e., boardSnapshotSize(b) bytes
+// without alignment requirements, which can be memcpy'd into arenas or replay
+// buffers. Both fail if the board has no bitsets.
+extern error_t boardSnapshot(const struct board_t *b, _out_ void *buf);
+extern error_t boardRestore(struct board_t *b, const void *buf);
+
 // Set and get the board position with value 'v'
 extern error_t boardSet(struct board_t *b, int row, int col, int v, int flag);
 extern error_t boardGet(struct board_t *p, int row, int col, int *v);
@@ -43,4 +110,17 @@ extern int boardRowForCol(struct board_t *b, int col);
 // Determines the current winner for board 'b'.
 extern enum player_t boardWinner(struct board_t *b);
 
+// Same as boardWinner but only checks the lines through the stone at
+// ('row', 'col'). Valid if the game had no winner before that stone.
+extern enum player_t boardWinnerAt(struct board_t *b, int row, int col);
+
+// Plays uniformly random columns, starting with 'next', until the game ends
+// and returns the winner. The board is modified in place.
+//
+// If 'moves' is not NULL, the columns played are recorded there, which must
+// hold rows * cols entries, and their count in 'num_moves'.
+extern enum player_t boardPlayout(struct board_t *b, enum player_t next,
+                                  struct rng64_t *rng, _out_ uint8_t *moves,
+                                  _out_ int *num_moves);
+
 #endif  // BB_BOARD_H_
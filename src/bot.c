@@ -1,10 +1,26 @@
 #include "bot.h"
 
+#include <string.h>  // memset
 #include <unistd.h>  // sleep
 
 // eva
 #include <rng/srng64.h>
 
+// bb
+#include "ab.h"
+#include "clock.h"
+#include "evcache.h"
+#include "mcts.h"
+#include "threats.h"
+#include "trace.h"
+
+#ifdef BB_NN
+#include "broker.h"
+#include "nn.h"
+#include "puct.h"
+#include "weights.h"
+#endif
+
 // -----------------------------------------------------------------------------
 // general public APis for all bots.
 // -----------------------------------------------------------------------------
@@ -30,6 +46,144 @@ botFree(struct bot_t *b)
         free(b);
 }
 
+// the player to move follows the previous stone; black moves first.
+static enum player_t
+nextPlayer(struct board_t *b, int prev_r, int prev_c)
+{
+        if (prev_r == -1) return PLAYER_BLACK;
+
+        int v;
+        boardGet(b, prev_r, prev_c, &v);
+        return v == PLAYER_BLACK ? PLAYER_WHITE : PLAYER_BLACK;
+}
+
+error_t
+botPlay(struct bot_t *bot, struct board_t *b, int prev_r, int prev_c, int *r,
+        int *c)
+{
+        struct bot_stats_t *s     = &bot->stats;
+        const uint64_t      start = nowNs();
+        error_t             err   = OK;
+
+        memset(s, 0, sizeof(*s));
+        TRACE_BEGIN(TRACE_BOT_MOVE);
+
+        int col;
+        // the threat-space search needs gravity.
+        if (bot->tactics > 0 && b->mode == 1 &&
+            (s->forced = threatsSearch(b, nextPlayer(b, prev_r, prev_c),
+                                       bot->tactics, &col)) != THREATS_NONE) {
+                *r        = boardRowForCol(b, col);
+                *c        = col;
+                s->pv[0]  = col;
+                s->pv_len = 1;
+        } else {
+                err = bot->bot_fn(b, bot->data, prev_r, prev_c, r, c, s);
+        }
+
+        TRACE_END(TRACE_BOT_MOVE);
+
+        s->wall_ns = nowNs() - start;
+        if (s->wall_ns > 0) s->nodes_per_sec = s->nodes * 1e9 / s->wall_ns;
+        if (s->tt_probes > 0) {
+                s->tt_hit_rate = (double)s->tt_hits / s->tt_probes;
+        }
+        if (s->cache_probes > 0) {
+                s->cache_hit_rate = (double)s->cache_hits / s->cache_probes;
+        }
+        if (s->cutoffs > 0) {
+                s->first_cut_rate = (double)s->first_cutoffs / s->cutoffs;
+        }
+        return err;
+}
+
+// appends 'v' with a k/M/G suffix.
+static void
+catCount(sds_t *str, double v)
+{
+        const char *units = " kMG";
+        int         i     = 0;
+        while (v >= 1000 && i < 3) {
+                v /= 1000;
+                i++;
+        }
+        if (i == 0) {
+                sdsCatPrintf(str, "%.0f", v);
+        } else {
+                sdsCatPrintf(str, "%.1f%c", v, units[i]);
+        }
+}
+
+void
+botStatsSummary(const struct bot_stats_t *s, sds_t *str)
+{
+        if (s->forced == THREATS_WIN) sdsCatPrintf(str, "forced win ");
+        if (s->forced == THREATS_BLOCK) sdsCatPrintf(str, "forced block ");
+
+        if (s->nodes > 0) {
+                catCount(str, s->nodes);
+                sdsCatPrintf(str, " nodes ");
+                catCount(str, s->nodes_per_sec);
+                sdsCatPrintf(str, "/s ");
+        }
+        if (s->playouts > 0) {
+                catCount(str, s->playouts);
+                sdsCatPrintf(str, " playouts ");
+        }
+        if (s->max_depth > 0) sdsCatPrintf(str, "d%d ", s->max_depth);
+        if (s->tt_probes > 0) {
+                sdsCatPrintf(str, "tt %.0f%% ", 100 * s->tt_hit_rate);
+        }
+        if (s->cache_probes > 0) {
+                sdsCatPrintf(str, "cache %.0f%% ", 100 * s->cache_hit_rate);
+        }
+        if (s->cutoffs > 0) {
+                sdsCatPrintf(str, "cut %.0f%% ", 100 * s->first_cut_rate);
+        }
+        sdsCatPrintf(str, "%.1fms", s->wall_ns / 1e6);
+        if (s->nodes > 0) sdsCatPrintf(str, " score %.2f", s->score);
+        if (s->pv_len > 0) {
+                sdsCatPrintf(str, " pv");
+                for (int i = 0; i < s->pv_len; i++) {
+                        sdsCatPrintf(str, " %d", s->pv[i]);
+                }
+        }
+}
+
+// -----------------------------------------------------------------------------
+// search stats.
+// -----------------------------------------------------------------------------
+
+// fills the table counters of the last search.
+static void
+ttStatsFill(const struct tt_stats_t *tt_stats, struct bot_stats_t *stats)
+{
+        stats->tt_probes = tt_stats->probes;
+        stats->tt_hits   = tt_stats->hits;
+}
+
+// the cache counters before a search; see cacheStatsEnd.
+static void
+cacheStatsBegin(struct evcache_t *cache, _out_ struct evcache_stats_t *before)
+{
+        memset(before, 0, sizeof(*before));
+        if (cache != NULL) evcacheStats(cache, before);
+}
+
+// fills the probes and hits since 'before', including those of concurrent
+// searches sharing the cache.
+static void
+cacheStatsEnd(struct evcache_t *cache, const struct evcache_stats_t *before,
+              struct bot_stats_t *stats)
+{
+        if (cache == NULL) return;
+
+        struct evcache_stats_t after;
+        evcacheStats(cache, &after);
+        stats->cache_probes = after.probes - before->probes;
+        stats->cache_hits   = after.hits - before->hits;
+}
+
 // -----------------------------------------------------------------------------
 // deterministic bot.
 // -----------------------------------------------------------------------------
@@ -37,7 +191,7 @@ botFree(struct bot_t *b)
 // bot_fn_deter always tries to place a stone in the first legitimate col.
 static error_t
 bot_fn_deter(struct board_t *b, void *data, int prev_r, int prev_c, int *r,
-             int *c)
+             int *c, struct bot_stats_t *stats)
 {
         const int cols = b->cols;
         int       row;
@@ -55,21 +209,22 @@ bot_fn_deter(struct board_t *b, void *data, int prev_r, int prev_c, int *r,
 
 static error_t
 bot_fn_deter_sleep(struct board_t *b, void *data, int prev_r, int prev_c,
-                   int *r, int *c)
+                   int *r, int *c, struct bot_stats_t *stats)
 {
         sleep(1);  // sleep for 1 sec to mimic a game and give a pause.
-        return bot_fn_deter(b, data, prev_r, prev_c, r, c);
+        return bot_fn_deter(b, data, prev_r, prev_c, r, c, stats);
 }
 
 struct bot_t *
 botNewDeterministic(const char *name, const char *msg, int try_sleep)
 {
-        struct bot_t *p = malloc(sizeof(*p));
+        struct bot_t *p = calloc(1, sizeof(*p));
         p->name         = sdsNew(name);
         p->msg          = sdsNew(msg);
         p->bot_fn       = try_sleep ? bot_fn_deter_sleep : bot_fn_deter;
         p->data         = NULL;
         p->free_fn      = NULL;
+        p->tactics      = THREATS_DEPTH;
         return p;
 }
 
@@ -99,7 +254,7 @@ random_free_fn(void *bot_p)
 //   - if not, try again until we reach 1000 times.
 static error_t
 bot_fn_random(struct board_t *b, void *data, int prev_r, int prev_c, int *r,
-              int *c)
+              int *c, struct bot_stats_t *stats)
 {
         const int       cols = b->cols;
         struct rng64_t *p    = data;
@@ -123,12 +278,13 @@ bot_fn_random(struct board_t *b, void *data, int prev_r, int prev_c, int *r,
 struct bot_t *
 botNewRandom(const char *name, const char *msg, uint64_t seed)
 {
-        struct bot_t *p = malloc(sizeof(*p));
+        struct bot_t *p = calloc(1, sizeof(*p));
         p->name         = sdsNew(name);
         p->msg          = sdsNew(msg);
         p->bot_fn       = bot_fn_random;
         p->data         = srng64New(seed);
         p->free_fn      = random_free_fn;
+        p->tactics      = THREATS_DEPTH;
 
         return p;
 }
@@ -136,15 +292,278 @@ botNewRandom(const char *name, const char *msg, uint64_t seed)
 // -----------------------------------------------------------------------------
 // Monte Carlo Tree Search (MCTS) bot.
 // -----------------------------------------------------------------------------
+static void
+mcts_free_fn(void *bot_p)
+{
+        struct bot_t  *b = (struct bot_t *)bot_p;
+        struct mcts_t *m = b->data;
+
+        mctsFree(m);
+
+        // After here, we call the standard free fn to free the rest of fields.
+        // Before that, we reset the data and free_fn to ensure it is safe.
+        b->data    = NULL;
+        b->free_fn = NULL;
+        botFree(b);
+}
+
+static error_t
+bot_fn_mcts(struct board_t *b, void *data, int prev_r, int prev_c, int *r,
+            int *c, struct bot_stats_t *stats)
+{
+        struct mcts_t *m = data;
+        int            col;
+
+        error_t err = mctsSearch(m, b, nextPlayer(b, prev_r, prev_c), &col);
+        if (err) {
+                return errEmitNote("mcts search failed.");
+        }
+
+        ttStatsFill(&m->tt_stats, stats);
+        stats->nodes     = m->num_nodes;
+        stats->playouts  = m->playouts;
+        stats->max_depth = m->max_depth;
+        stats->score     = m->score;
+        stats->pv_len    = mctsPV(m, stats->pv, BOT_PV_MAX);
+
+        *r = boardRowForCol(b, col);
+        *c = col;
+        return OK;
+}
+
 struct bot_t *
-botNewMCTS(const char *name, const char *msg, uint64_t seed)
+botNewMCTS(const char *name, const char *msg, const struct bot_opts_t *opts)
 {
-        struct bot_t *p = malloc(sizeof(*p));
+        struct mcts_opts_t mcts_opts = {
+            .playouts = opts->mcts_playouts,
+            .nodes    = opts->mcts_nodes,
+            .rave     = opts->mcts_rave,
+        };
+
+        struct bot_t *p = calloc(1, sizeof(*p));
         p->name         = sdsNew(name);
         p->msg          = sdsNew(msg);
-        p->bot_fn       = NULL;  // TODO: replace here.
-        p->data         = NULL;
-        p->free_fn      = NULL;
+        p->bot_fn       = bot_fn_mcts;
+        p->data         = mctsNew(&mcts_opts, opts->seed, opts->tt);
+        p->free_fn      = mcts_free_fn;
+        p->tactics      = THREATS_DEPTH;
+
+        return p;
+}
+
+// -----------------------------------------------------------------------------
+// Alpha-beta bot.
+// -----------------------------------------------------------------------------
+static void
+ab_free_fn(void *bot_p)
+{
+        struct bot_t *b = (struct bot_t *)bot_p;
+        struct ab_t  *a = b->data;
+
+        abFree(a);
+
+        // After here, we call the standard free fn to free the rest of fields.
+        // Before that, we reset the data and free_fn to ensure it is safe.
+        b->data    = NULL;
+        b->free_fn = NULL;
+        botFree(b);
+}
+
+static error_t
+bot_fn_ab(struct board_t *b, void *data, int prev_r, int prev_c, int *r,
+          int *c, struct bot_stats_t *stats)
+{
+        struct ab_t           *a    = data;
+        enum player_t          next = nextPlayer(b, prev_r, prev_c);
+        struct evcache_stats_t cache_before;
+        int                    col;
+
+        cacheStatsBegin(a->cache, &cache_before);
+        error_t err = abSearch(a, b, next, &col);
+        if (err) {
+                return errEmitNote("alpha-beta search failed.");
+        }
+
+        ttStatsFill(&a->tt_stats, stats);
+        cacheStatsEnd(a->cache, &cache_before, stats);
+        stats->nodes         = a->nodes;
+        stats->max_depth     = a->depth;
+        stats->cutoffs       = a->cutoffs;
+        stats->first_cutoffs = a->first_cutoffs;
+        stats->score         = a->score;
+        stats->pv_len        = abPV(a, next, stats->pv, BOT_PV_MAX);
+
+        *r = boardRowForCol(b, col);
+        *c = col;
+        return OK;
+}
+
+struct bot_t *
+botNewAlphaBeta(const char *name, const char *msg,
+                const struct bot_opts_t *opts)
+{
+        struct ab_opts_t ab_opts = {
+            .depth = opts->ab_depth,
+        };
+
+        struct ab_t *a = abNew(&ab_opts, opts->tt);
+        a->cache       = opts->eval_cache;
+
+        struct bot_t *p = calloc(1, sizeof(*p));
+        p->name         = sdsNew(name);
+        p->msg          = sdsNew(msg);
+        p->bot_fn       = bot_fn_ab;
+        p->data         = a;
+        p->free_fn      = ab_free_fn;
+        p->tactics      = THREATS_DEPTH;
+
+        return p;
+}
+
+#ifdef BB_NN
+// -----------------------------------------------------------------------------
+// PUCT bot, guided by a policy/value network.
+// -----------------------------------------------------------------------------
+
+struct puct_bot_t {
+        struct puct_t           *puct;     // owned.
+        struct nn_t             *nn;       // owned. NULL before first move.
+        struct broker_t         *broker;   // unowned. replaces 'nn' if set.
+        struct weights_handle_t *weights;  // unowned. NULL-able.
+        struct nn_opts_t         nn_opts;
+        struct evcache_t        *cache;    // unowned. NULL-able.
+        struct evcache_eval_t    front;    // wraps the network with a cache.
+};
+
+// salts the cache entries of a network. networks built with the same options
+// have the same initial weights, so they share entries; those behind a broker
+// share them by the broker. published weights add their version.
+static uint64_t
+puctCacheSalt(const struct puct_bot_t *p)
+{
+        uint64_t salt = EVCACHE_SALT_NN;
+        if (p->weights != NULL) {
+                salt ^= weightsVersion(p->weights) * 0xff51afd7ed558ccdULL;
+        }
+        if (p->broker != NULL) return salt ^ (uint64_t)(uintptr_t)p->broker;
+
+        const struct nn_opts_t *o = &p->nn_opts;
+        return salt ^ o->seed * 0x9e3779b97f4a7c15ULL ^
+               (uint64_t)o->hidden << 32 ^ (uint64_t)o->rows << 16 ^
+               (uint64_t)o->cols;
+}
+
+static void
+puct_free_fn(void *bot_p)
+{
+        struct bot_t      *b = (struct bot_t *)bot_p;
+        struct puct_bot_t *p = b->data;
+
+        puctFree(p->puct);
+        nnFree(p->nn);
+        free(p);
+
+        // After here, we call the standard free fn to free the rest of fields.
+        // Before that, we reset the data and free_fn to ensure it is safe.
+        b->data    = NULL;
+        b->free_fn = NULL;
+        botFree(b);
+}
+
+static error_t
+bot_fn_puct(struct board_t *b, void *data, int prev_r, int prev_c, int *r,
+            int *c, struct bot_stats_t *stats)
+{
+        struct puct_bot_t     *p = data;
+        struct evcache_stats_t cache_before;
+        int                    col;
+
+        // the network is shaped by the board, so it is built on first use.
+        if (p->broker == NULL &&
+            (p->nn == NULL || p->nn_opts.rows != b->rows ||
+             p->nn_opts.cols != b->cols)) {
+                nnFree(p->nn);
+                p->nn           = NULL;
+                p->nn_opts.rows = b->rows;
+                p->nn_opts.cols = b->cols;
+                if (nnNew(&p->nn_opts, &p->nn)) {
+                        return errEmitNote("failed to build the network.");
+                }
+                if (p->weights != NULL && nnAttach(p->nn, p->weights)) {
+                        return errEmitNote("failed to attach the weights.");
+                }
+                if (p->cache != NULL) {
+                        p->front.ctx = p->nn;
+                } else {
+                        p->puct->ctx = p->nn;
+                }
+        }
+
+        // a version published during the move may only be used by later
+        // batches, so entries stored meanwhile may come from either one.
+        if (p->cache != NULL) p->front.salt = puctCacheSalt(p);
+
+        cacheStatsBegin(p->cache, &cache_before);
+        error_t err = puctSearch(p->puct, b, nextPlayer(b, prev_r, prev_c),
+                                 &col);
+        if (err) {
+                return errEmitNote("puct search failed.");
+        }
+
+        cacheStatsEnd(p->cache, &cache_before, stats);
+        stats->nodes     = p->puct->num_nodes;
+        stats->playouts  = p->puct->playouts;
+        stats->max_depth = p->puct->max_depth;
+        stats->score     = p->puct->score;
+        stats->pv_len    = puctPV(p->puct, stats->pv, BOT_PV_MAX);
+
+        *r = boardRowForCol(b, col);
+        *c = col;
+        return OK;
+}
+
+struct bot_t *
+botNewPUCT(const char *name, const char *msg, const struct bot_opts_t *opts)
+{
+        struct puct_opts_t puct_opts = {
+            .playouts = opts->puct_playouts,
+            .batch    = opts->puct_batch,
+        };
+
+        struct puct_bot_t *data = calloc(1, sizeof(*data));
+        data->broker            = opts->broker;
+        data->weights           = opts->weights;
+        data->cache             = opts->eval_cache;
+
+        // the network is built on the first move, unless behind a broker.
+        puct_eval_fn eval = opts->broker != NULL ? brokerEval : nnEval;
+        void        *ctx  = opts->broker;
+        if (data->cache != NULL) {
+                data->front = (struct evcache_eval_t){
+                    .cache = data->cache,
+                    .eval  = eval,
+                    .ctx   = ctx,
+                    .salt  = puctCacheSalt(data),
+                };
+                eval = evcacheEval;
+                ctx  = &data->front;
+        }
+
+        data->puct    = puctNew(&puct_opts, eval, ctx);
+        data->nn_opts = (struct nn_opts_t){
+            .batch  = data->puct->opts.batch,
+            .hidden = opts->nn_hidden,
+            .seed   = opts->seed,
+        };
+
+        struct bot_t *p = calloc(1, sizeof(*p));
+        p->name         = sdsNew(name);
+        p->msg          = sdsNew(msg);
+        p->bot_fn       = bot_fn_puct;
+        p->data         = data;
+        p->free_fn      = puct_free_fn;
+        p->tactics      = THREATS_DEPTH;
 
         return p;
 }
+#endif  // BB_NN
@@ -8,13 +8,48 @@
 
 // bb
 #include "board.h"
+#include "tt.h"
 
 // -----------------------------------------------------------------------------
 // bots
 // -----------------------------------------------------------------------------
 
+#define BOT_PV_MAX 16
+
+struct broker_t;
+struct evcache_t;
+struct weights_handle_t;
+
+// Telemetry of the last move, filled by botPlay. Search fields a bot does not
+// have stay zero.
+struct bot_stats_t {
+        uint64_t nodes;           // nodes searched or created.
+        uint64_t playouts;        // mcts only.
+        int      max_depth;       // deepest ply searched.
+        uint64_t tt_probes;       // table probes of the search.
+        uint64_t tt_hits;         //
+        uint64_t wall_ns;         // wall time of the move.
+        double   nodes_per_sec;   // nodes / wall time.
+        double   tt_hit_rate;     // tt_hits / tt_probes. 0 without probes.
+        uint64_t cache_probes;    // shared evaluation cache probes.
+        uint64_t cache_hits;      //
+        double   cache_hit_rate;  // cache_hits / cache_probes.
+        uint64_t cutoffs;         // alpha-beta only. beta cutoffs.
+        uint64_t first_cutoffs;   // by the first move searched.
+        double   first_cut_rate;  // first_cutoffs / cutoffs: move ordering.
+
+        // score of the chosen move for the mover: the expected result in
+        // [0, 1] for mcts; the negamax score for alpha-beta.
+        double score;
+
+        int     forced;  // THREATS_* if the threat-space search moved.
+        int     pv_len;
+        uint8_t pv[BOT_PV_MAX];  // principal variation, as columns.
+};
+
+// 'stats' is cleared by botPlay before the call; the fn fills what it knows.
 typedef error_t (*bot_fn)(struct board_t *, void *data, int prev_r, int prev_c,
-                          int *r, int *c);
+                          int *r, int *c, struct bot_stats_t *stats);
 
 struct bot_t {
         sds_t  name;              // owned
@@ -22,15 +57,72 @@ struct bot_t {
         bot_fn bot_fn;            // the bot fn.
         void  *data;              // private data. passed to bot_fn.
         void (*free_fn)(void *);  // free fn to call if not NULL;
+
+        // threat-space search depth run by botPlay before bot_fn, on boards
+        // with gravity only. 0 => off. THREATS_DEPTH for all bots built here.
+        int tactics;
+
+        struct bot_stats_t stats;  // of the last botPlay.
+};
+
+// Options for the search bots.
+//
+// The mcts and alpha-beta bots given the same transposition table share it,
+// also across threads. The caller owns the table and frees it after the last
+// bot using it. The alpha-beta and puct bots share an evaluation cache (see
+// src/evcache.h) the same way.
+struct bot_opts_t {
+        uint64_t          seed;        // seed for the rng.
+        struct tt_t      *tt;          // unowned. NULL => no table.
+        struct evcache_t *eval_cache;  // unowned. NULL => no cache.
+
+        // mcts. 0 => default.
+        int mcts_playouts;  // playouts per move.
+        int mcts_nodes;     // node arena capacity.
+        int mcts_rave;      // 1 to enable RAVE.
+
+        // alpha-beta. 0 => default.
+        int ab_depth;  // max depth of the iterative deepening.
+
+        // puct, built with NN=1. 0 => default.
+        int puct_playouts;  // leaf evaluations per move.
+        int puct_batch;     // leaves per network call.
+        int nn_hidden;      // units of the hidden layers.
+
+        // evaluates for all puct bots through one network, e.g., for bots
+        // searching on several threads. NULL => each bot owns a network.
+        struct broker_t *broker;  // unowned.
+
+        // the latest weights published by a trainer, loaded by the networks
+        // the bots own between two batches. NULL => initial weights only.
+        struct weights_handle_t *weights;  // unowned.
 };
 
 extern void botFree(struct bot_t *b);
 
+// Asks the bot for its next move. With tactics enabled, wins and forced blocks
+// found by the threat-space search are played without calling bot_fn.
+extern error_t botPlay(struct bot_t *bot, struct board_t *b, int prev_r,
+                       int prev_c, _out_ int *r, _out_ int *c);
+
+// Appends a one-line summary of 's' to 'str', e.g.,
+//   "12.3k nodes 1.2M/s d9 tt 43% cut 86% 12ms score 0.61 pv 3 4 3"
+extern void botStatsSummary(const struct bot_stats_t *s, sds_t *str);
+
 extern struct bot_t *botNewDeterministic(const char *name, const char *msg,
                                          int try_sleep);
 extern struct bot_t *botNewRandom(const char *name, const char *msg,
                                   uint64_t seed);
 extern struct bot_t *botNewMCTS(const char *name, const char *msg,
-                                uint64_t seed);
+                                const struct bot_opts_t *opts);
+extern struct bot_t *botNewAlphaBeta(const char *name, const char *msg,
+                                     const struct bot_opts_t *opts);
+
+#ifdef BB_NN
+// AlphaZero-style search with a policy/value network (see src/puct.h and
+// src/nn.h). The network is not trained here; it starts from 'seed'.
+extern struct bot_t *botNewPUCT(const char *name, const char *msg,
+                                const struct bot_opts_t *opts);
+#endif
 
 #endif  // BB_BOT_H_
@@ -0,0 +1,337 @@
+#include "broker.h"
+
+#include <sched.h>   // sched_yield
+#include <stdlib.h>  // malloc
+#include <string.h>  // memcpy
+#include <time.h>
+
+// bb
+#include "clock.h"
+#include "trace.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define DEFAULT_BATCH      16
+#define DEFAULT_TIMEOUT_NS (1000 * 1000)
+
+// the requests of one brokerEval. answered under 'mu', so the caller cannot
+// return while the executor still uses it.
+struct broker_call_t {
+        int             remaining;
+        int             failed;
+        pthread_mutex_t mu;
+        pthread_cond_t  cv;
+};
+
+static void
+queuePush(struct broker_t *br, struct broker_req_t *r)
+{
+        atomic_store_explicit(&r->next, NULL, memory_order_relaxed);
+        struct broker_req_t *prev = atomic_exchange(&br->tail, r);
+        // between the exchange and this store, the queue looks empty past
+        // 'prev' to the executor.
+        atomic_store(&prev->next, r);
+}
+
+// returns the oldest request, or NULL if the queue is empty or its next
+// request is still being linked. executor only.
+static struct broker_req_t *
+queuePop(struct broker_t *br)
+{
+        struct broker_req_t *head = br->head;
+        struct broker_req_t *next = atomic_load(&head->next);
+
+        if (head == &br->stub) {
+                if (next == NULL) return NULL;
+                br->head = next;
+                head     = next;
+                next     = atomic_load(&head->next);
+        }
+        if (next != NULL) {
+                br->head = next;
+                return head;
+        }
+
+        // 'head' is the last request. the stub goes behind it, so it can be
+        // taken out, unless another push got in first.
+        if (head != atomic_load(&br->tail)) return NULL;
+        queuePush(br, &br->stub);
+        next = atomic_load(&head->next);
+        if (next != NULL) {
+                br->head = next;
+                return head;
+        }
+        return NULL;
+}
+
+// wakes the executor up if it sleeps.
+static void
+executorWake(struct broker_t *br)
+{
+        if (!atomic_load(&br->idle)) return;
+        pthread_mutex_lock(&br->mu);
+        pthread_cond_signal(&br->cv);
+        pthread_mutex_unlock(&br->mu);
+}
+
+// sleeps until a push, a stop, or 'deadline' unless 0. returns at once if a
+// push is only half done.
+//
+// 'idle' is set before the queue is checked and read by producers after their
+// push, so either the executor sees the request or the producer sees it idle
+// and signals; the mutex keeps the signal from landing before the wait.
+static void
+executorWait(struct broker_t *br, uint64_t deadline)
+{
+        pthread_mutex_lock(&br->mu);
+        atomic_store(&br->idle, 1);
+        if (br->head == &br->stub && atomic_load(&br->stub.next) == NULL &&
+            !atomic_load(&br->stop)) {
+                if (deadline == 0) {
+                        pthread_cond_wait(&br->cv, &br->mu);
+                } else {
+                        struct timespec ts = {
+                            .tv_sec  = deadline / 1000000000,
+                            .tv_nsec = deadline % 1000000000,
+                        };
+                        pthread_cond_timedwait(&br->cv, &br->mu, &ts);
+                }
+        } else if (br->head != &br->stub) {
+                sched_yield();
+        }
+        atomic_store(&br->idle, 0);
+        pthread_mutex_unlock(&br->mu);
+}
+
+// answers 'count' requests of 'call'.
+static void
+callDone(struct broker_call_t *call, int count, int failed)
+{
+        pthread_mutex_lock(&call->mu);
+        call->remaining -= count;
+        call->failed |= failed;
+        if (call->remaining == 0) pthread_cond_signal(&call->cv);
+        pthread_mutex_unlock(&call->mu);
+}
+
+// evaluates the 'k' popped requests and answers them.
+static void
+executorRunBatch(struct broker_t *br, int k)
+{
+        const int      cols  = br->opts.cols;
+        const uint64_t start = nowNs();
+
+        for (int i = 0; i < k; i++) {
+                struct broker_req_t *r    = br->reqs[i];
+                const uint64_t       wait = start - r->submit_ns;
+                br->boards[i]             = r->b;
+
+                uint64_t max = atomic_load_explicit(&br->wait_ns_max,
+                                                    memory_order_relaxed);
+                if (wait > max) atomic_store(&br->wait_ns_max, wait);
+                atomic_fetch_add(&br->wait_ns, wait);
+                atomic_fetch_add(&br->wait_hist[63 - __builtin_clzll(wait | 1)],
+                                 1);
+        }
+
+        TRACE_BEGIN(TRACE_EVAL);
+        const int failed =
+            br->eval(br->ctx, br->boards, k, br->policy, br->value) != OK;
+        TRACE_END(TRACE_EVAL);
+
+        atomic_fetch_add(&br->eval_ns, nowNs() - start);
+        atomic_fetch_add(&br->batches, 1);
+        atomic_fetch_add(&br->evals, k);
+        if (k == br->opts.batch) atomic_fetch_add(&br->full, 1);
+
+        // requests of one call are mostly adjacent; each run of them takes
+        // one lock.
+        int run = 0;
+        for (int i = 0; i < k; i++) {
+                struct broker_req_t *r = br->reqs[i];
+                if (!failed) {
+                        memcpy(r->policy, br->policy + i * cols,
+                               cols * sizeof(float));
+                        *r->value = br->value[i];
+                }
+
+                run++;
+                if (i + 1 == k || br->reqs[i + 1]->call != r->call) {
+                        callDone(r->call, run, failed);
+                        run = 0;
+                }
+        }
+}
+
+static void *
+executorRun(void *arg)
+{
+        struct broker_t *br = arg;
+
+        while (1) {
+                int      k        = 0;
+                uint64_t deadline = 0;
+
+                while (k < br->opts.batch) {
+                        struct broker_req_t *r = queuePop(br);
+                        if (r != NULL) {
+                                if (k == 0) {
+                                        deadline = nowNs() +
+                                                   br->opts.timeout_ns;
+                                }
+                                br->reqs[k++] = r;
+                                continue;
+                        }
+
+                        if (k > 0 && nowNs() >= deadline) break;
+                        if (k == 0 && atomic_load(&br->stop)) return NULL;
+                        executorWait(br, deadline);
+                }
+
+                executorRunBatch(br, k);
+        }
+}
+
+// the upper bound of the bucket holding the 'q' quantile.
+static uint64_t
+histQuantile(const uint64_t *hist, uint64_t total, double q)
+{
+        uint64_t sum = 0;
+        for (int i = 0; i < 64; i++) {
+                sum += hist[i];
+                if (sum > 0 && sum >= q * total) {
+                        return i == 63 ? UINT64_MAX : (2ULL << i) - 1;
+                }
+        }
+        return 0;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+error_t
+brokerNew(const struct broker_opts_t *opts, puct_eval_fn eval, void *ctx,
+          struct broker_t **out)
+{
+        struct broker_t *br = calloc(1, sizeof(*br));
+        br->opts            = *opts;
+        if (br->opts.batch <= 0) br->opts.batch = DEFAULT_BATCH;
+        if (br->opts.timeout_ns == 0) br->opts.timeout_ns = DEFAULT_TIMEOUT_NS;
+
+        const int batch = br->opts.batch;
+
+        br->eval   = eval;
+        br->ctx    = ctx;
+        br->head   = &br->stub;
+        br->reqs   = malloc(batch * sizeof(*br->reqs));
+        br->boards = malloc(batch * sizeof(*br->boards));
+        br->policy = malloc(batch * opts->cols * sizeof(*br->policy));
+        br->value  = malloc(batch * sizeof(*br->value));
+        atomic_init(&br->stub.next, NULL);
+        atomic_init(&br->tail, &br->stub);
+        atomic_init(&br->idle, 0);
+        atomic_init(&br->stop, 0);
+
+        // the executor waits for monotonic deadlines.
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_mutex_init(&br->mu, NULL);
+        pthread_cond_init(&br->cv, &attr);
+        pthread_condattr_destroy(&attr);
+
+        if (pthread_create(&br->tid, NULL, executorRun, br)) {
+                pthread_cond_destroy(&br->cv);
+                pthread_mutex_destroy(&br->mu);
+                free(br->reqs);
+                free(br->boards);
+                free(br->policy);
+                free(br->value);
+                free(br);
+                return errNew("failed to start the broker executor.");
+        }
+
+        *out = br;
+        return OK;
+}
+
+void
+brokerFree(struct broker_t *br)
+{
+        if (br == NULL) return;
+
+        atomic_store(&br->stop, 1);
+        pthread_mutex_lock(&br->mu);
+        pthread_cond_signal(&br->cv);
+        pthread_mutex_unlock(&br->mu);
+        pthread_join(br->tid, NULL);
+
+        pthread_cond_destroy(&br->cv);
+        pthread_mutex_destroy(&br->mu);
+        free(br->reqs);
+        free(br->boards);
+        free(br->policy);
+        free(br->value);
+        free(br);
+}
+
+error_t
+brokerEval(void *ctx, struct board_t *const *boards, int n, float *policy,
+           float *value)
+{
+        struct broker_t *br = ctx;
+        if (n == 0) return OK;
+
+        struct broker_call_t call = {.remaining = n};
+        pthread_mutex_init(&call.mu, NULL);
+        pthread_cond_init(&call.cv, NULL);
+
+        struct broker_req_t reqs[n];
+        const uint64_t      now = nowNs();
+        for (int i = 0; i < n; i++) {
+                reqs[i].b         = boards[i];
+                reqs[i].policy    = policy + i * br->opts.cols;
+                reqs[i].value     = value + i;
+                reqs[i].submit_ns = now;
+                reqs[i].call      = &call;
+                queuePush(br, &reqs[i]);
+        }
+        executorWake(br);
+
+        pthread_mutex_lock(&call.mu);
+        while (call.remaining > 0) pthread_cond_wait(&call.cv, &call.mu);
+        pthread_mutex_unlock(&call.mu);
+
+        pthread_cond_destroy(&call.cv);
+        pthread_mutex_destroy(&call.mu);
+
+        if (call.failed) return errNew("failed to evaluate %d positions.", n);
+        return OK;
+}
+
+void
+brokerStats(struct broker_t *br, struct broker_stats_t *s)
+{
+        memset(s, 0, sizeof(*s));
+        s->batches     = atomic_load(&br->batches);
+        s->evals       = atomic_load(&br->evals);
+        s->full        = atomic_load(&br->full);
+        s->wait_ns_max = atomic_load(&br->wait_ns_max);
+        if (s->batches == 0) return;
+
+        s->occupancy    = (double)s->evals / (s->batches * br->opts.batch);
+        s->wait_ns_mean = atomic_load(&br->wait_ns) / s->evals;
+        s->eval_ns_mean = atomic_load(&br->eval_ns) / s->batches;
+
+        uint64_t hist[64];
+        uint64_t total = 0;
+        for (int i = 0; i < 64; i++) {
+                hist[i] = atomic_load(&br->wait_hist[i]);
+                total += hist[i];
+        }
+        s->wait_ns_p50 = histQuantile(hist, total, 0.50);
+        s->wait_ns_p99 = histQuantile(hist, total, 0.99);
+}
@@ -0,0 +1,120 @@
+#ifndef BB_BROKER_H_
+#define BB_BROKER_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+
+// bb
+#include "board.h"
+#include "puct.h"
+
+// -----------------------------------------------------------------------------
+// Batched evaluation broker.
+// -----------------------------------------------------------------------------
+//
+// An evaluator such as nnEval runs on one thread, as vmBatch on a vm_t is not
+// thread-safe, and is much cheaper per position in large batches. The broker
+// owns that thread, the executor, and lets any number of search threads share
+// it:
+//
+//   - brokerEval pushes one request per position onto a lock-free MPSC queue
+//     (Vyukov's intrusive list) and blocks until all are answered. Requests
+//     live on the caller's stack, so submitting allocates nothing.
+//   - the executor pops requests until it has 'batch' of them or 'timeout_ns'
+//     passed since it popped the first, calls the evaluator once for all of
+//     them and copies each result back to its caller.
+//
+// A larger batch or timeout improves throughput at the cost of move latency;
+// brokerStats reports the batch occupancy and the queue latency to tune them.
+
+struct broker_opts_t {
+        int      cols;        // of the boards evaluated.
+        int      batch;       // max positions per evaluator call.
+        uint64_t timeout_ns;  // max wait for a batch to fill.
+};
+
+struct broker_stats_t {
+        uint64_t batches;    // evaluator calls.
+        uint64_t evals;      // positions evaluated.
+        uint64_t full;       // batches sent full; the others timed out.
+        double   occupancy;  // evals / (batches * batch).
+
+        // queue latency: from submission to the evaluator call.
+        uint64_t wait_ns_mean;
+        uint64_t wait_ns_p50;  // upper bound of the log2 bucket.
+        uint64_t wait_ns_p99;  //
+        uint64_t wait_ns_max;
+
+        uint64_t eval_ns_mean;  // per evaluator call.
+};
+
+struct broker_call_t;
+
+// A queued position. Private to broker.c.
+struct broker_req_t {
+        _Atomic(struct broker_req_t *) next;
+
+        struct board_t       *b;
+        float                *policy;  // [cols]
+        float                *value;
+        uint64_t              submit_ns;
+        struct broker_call_t *call;
+};
+
+struct broker_t {
+        struct broker_opts_t opts;
+
+        puct_eval_fn eval;
+        void        *ctx;  // unowned. passed to eval.
+
+        // the queue. producers swap the tail; the executor owns the head.
+        _Atomic(struct broker_req_t *) tail;
+        struct broker_req_t           *head;
+        struct broker_req_t            stub;
+
+        // wakes the executor up when it sleeps on an empty queue.
+        pthread_mutex_t mu;
+        pthread_cond_t  cv;
+        atomic_int      idle;
+        atomic_int      stop;
+        pthread_t       tid;
+
+        // owned by the executor.
+        struct broker_req_t **reqs;    // [batch]
+        struct board_t      **boards;  // [batch]
+        float                *policy;  // [batch * cols]
+        float                *value;   // [batch]
+
+        _Atomic(uint64_t) batches;
+        _Atomic(uint64_t) evals;
+        _Atomic(uint64_t) full;
+        _Atomic(uint64_t) wait_ns;
+        _Atomic(uint64_t) wait_ns_max;
+        _Atomic(uint64_t) wait_hist[64];  // by the log2 of the wait.
+        _Atomic(uint64_t) eval_ns;
+};
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+// Starts the executor. 'eval' is only called from it.
+extern error_t brokerNew(const struct broker_opts_t *opts, puct_eval_fn eval,
+                         void *ctx, _out_ struct broker_t **broker);
+
+// Answers the requests still queued and stops the executor. No brokerEval may
+// be running.
+extern void brokerFree(struct broker_t *broker);
+
+// A puct_eval_fn with 'ctx' as the broker_t. Thread-safe.
+extern error_t brokerEval(void *ctx, struct board_t *const *boards, int n,
+                          _out_ float *policy, _out_ float *value);
+
+extern void brokerStats(struct broker_t *broker,
+                        _out_ struct broker_stats_t *stats);
+
+#endif  // BB_BROKER_H_
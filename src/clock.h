@@ -0,0 +1,20 @@
+#ifndef BB_CLOCK_H_
+#define BB_CLOCK_H_
+
+#include <stdint.h>  // uint64_t
+#include <time.h>    // clock_gettime
+
+// -----------------------------------------------------------------------------
+// Clock.
+// -----------------------------------------------------------------------------
+
+// Returns the monotonic clock in ns, to time intervals.
+static inline uint64_t
+nowNs(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif  // BB_CLOCK_H_
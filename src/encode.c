@@ -0,0 +1,194 @@
+#include "encode.h"
+
+#include <string.h>  // memset
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// mlvm
+#include "vm.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+// writes bits 0..n-1 of 'bits' as 1.0 or 0.0 to dst[0..n-1]. 'end' bounds
+// the buffer: the vector paths store 8 values when they fit, so values past n
+// are clobbered and must be written after this call.
+static inline void
+expandBits(float *dst, const float *end, uint64_t bits, int n)
+{
+        for (; n > 0; n -= 8, bits >>= 8, dst += 8) {
+#if defined(__AVX2__)
+                if (dst + 8 <= end) {
+                        const __m256i m = _mm256_setr_epi32(1, 2, 4, 8, 16, 32,
+                                                            64, 128);
+                        const __m256i v = _mm256_and_si256(
+                            _mm256_set1_epi32(bits & 0xff), m);
+                        const __m256 one = _mm256_set1_ps(1.0f);
+                        _mm256_storeu_ps(
+                            dst,
+                            _mm256_and_ps(_mm256_castsi256_ps(
+                                              _mm256_cmpeq_epi32(v, m)),
+                                          one));
+                        continue;
+                }
+#elif defined(__SSE2__)
+                if (dst + 8 <= end) {
+                        const __m128i m_lo = _mm_setr_epi32(1, 2, 4, 8);
+                        const __m128i m_hi = _mm_setr_epi32(16, 32, 64, 128);
+                        const __m128i v    = _mm_set1_epi32(bits & 0xff);
+                        const __m128  one  = _mm_set1_ps(1.0f);
+                        __m128i lo = _mm_cmpeq_epi32(_mm_and_si128(v, m_lo),
+                                                     m_lo);
+                        __m128i hi = _mm_cmpeq_epi32(_mm_and_si128(v, m_hi),
+                                                     m_hi);
+                        _mm_storeu_ps(dst,
+                                      _mm_and_ps(_mm_castsi128_ps(lo), one));
+                        _mm_storeu_ps(dst + 4,
+                                      _mm_and_ps(_mm_castsi128_ps(hi), one));
+                        continue;
+                }
+#endif
+                const int len = n < 8 ? n : 8;
+                for (int i = 0; i < len; i++) dst[i] = (bits >> i) & 1;
+        }
+}
+
+// encodes a bitboard. 'end' bounds the whole output.
+static void
+encodeBitsets(const struct board_t *b, int mirror, float *dst,
+              const float *end)
+{
+        const int rows  = b->rows;
+        const int cols  = b->cols;
+        const int plane = rows * cols;
+        const int words = b->words;
+
+        const int black = bitsetPopcount(b->stones[0], words) ==
+                          bitsetPopcount(b->stones[1], words);
+        const uint64_t *own = b->stones[black ? 0 : 1];
+        const uint64_t *opp = b->stones[black ? 1 : 0];
+
+        // plane by plane, in memory order, so each vector store only clobbers
+        // values written later. the columns are extracted again per plane,
+        // which is cheaper than keeping the bits of all of them.
+        for (int k = 0; k < ENCODE_BLACK; k++) {
+                for (int i = 0; i < cols; i++) {
+                        const int c   = mirror ? cols - 1 - i : i;
+                        const int pos = c * b->height;
+
+                        uint64_t bits;
+                        if (k == ENCODE_OWN) {
+                                bits = bitsetExtract(own, words, pos, rows);
+                        } else if (k == ENCODE_OPP) {
+                                bits = bitsetExtract(opp, words, pos, rows);
+                        } else {
+                                // stones stack from bit 0, so the lowest
+                                // empty cell is the next bit above them; none
+                                // if the column is full.
+                                const uint64_t next =
+                                    (bitsetExtract(own, words, pos, rows) |
+                                     bitsetExtract(opp, words, pos, rows)) +
+                                    1;
+                                bits = next >> rows == 0 ? next : 0;
+                        }
+                        expandBits(dst + k * plane + i * rows, end, bits,
+                                   rows);
+                }
+        }
+
+        float *side = dst + ENCODE_BLACK * plane;
+        for (int i = 0; i < plane; i++) side[i] = black;
+}
+
+// encodes a board of the states[] backend, cell by cell.
+static void
+encodeStates(struct board_t *b, int mirror, float *dst)
+{
+        const int rows  = b->rows;
+        const int cols  = b->cols;
+        const int plane = rows * cols;
+
+        int count = 0;
+        for (int r = 0; r < rows; r++) {
+                for (int c = 0; c < cols; c++) {
+                        int v;
+                        boardGet(b, r, c, &v);
+                        count += v;  // black is 1, white is -1.
+                }
+        }
+        const int           black = count == 0;
+        const enum player_t me    = black ? PLAYER_BLACK : PLAYER_WHITE;
+
+        memset(dst, 0, ENCODE_PLANES * plane * sizeof(float));
+        for (int i = 0; i < cols; i++) {
+                const int c   = mirror ? cols - 1 - i : i;
+                float    *col = dst + i * rows;
+
+                int h = 0;  // stones in the column.
+                for (int k = 0; k < rows; k++) {
+                        int v;
+                        boardGet(b, rows - 1 - k, c, &v);
+                        if (v == PLAYER_NA) break;
+                        col[(v == me ? ENCODE_OWN : ENCODE_OPP) * plane + k] =
+                            1;
+                        h++;
+                }
+                if (h < rows) col[ENCODE_LEGAL * plane + h] = 1;
+        }
+
+        float *side = dst + ENCODE_BLACK * plane;
+        for (int i = 0; i < plane; i++) side[i] = black;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+void
+encodeBoards(struct board_t *const *boards, int n, const uint8_t *mirror,
+             float *dst)
+{
+        if (n == 0) return;
+
+        const int    size = encodeSize(boards[0]);
+        const float *end  = dst + (size_t)n * size;
+
+        for (int i = 0; i < n; i++) {
+                struct board_t *b = boards[i];
+                const int       m = mirror != NULL && mirror[i];
+                if (b->words != 0) {
+                        encodeBitsets(b, m, dst + (size_t)i * size, end);
+                } else {
+                        encodeStates(b, m, dst + (size_t)i * size);
+                }
+        }
+}
+
+error_t
+encodeBatch(struct vm_t *vm, int td, struct board_t *const *boards, int n,
+            const uint8_t *mirror)
+{
+        if (n == 0) return OK;
+
+        struct shape_t *sp;
+        error_t         err = vmTensorInfo(vm, td, /*dtype=*/NULL, &sp);
+        if (err) return errEmitNote("failed to grab the tensor shape.");
+
+        const int size = encodeSize(boards[0]);
+        if (sp->rank != 2 || sp->dims[1] != size || sp->dims[0] < n) {
+                return errNew("expect shape [>=%d, %d] for %d boards.", n,
+                              size, n);
+        }
+
+        float *data;
+        err = vmTensorData(vm, td, (void **)&data);
+        if (err) return errEmitNote("failed to get the tensor data.");
+
+        encodeBoards(boards, n, mirror, data);
+        memset(data + (size_t)n * size, 0,
+               (size_t)(sp->dims[0] - n) * size * sizeof(float));
+        return OK;
+}
@@ -0,0 +1,56 @@
+#ifndef BB_ENCODE_H_
+#define BB_ENCODE_H_
+
+#include <stdint.h>  // uint8_t
+
+// eva
+#include <base/error.h>
+
+// bb
+#include "board.h"
+
+// -----------------------------------------------------------------------------
+// Board to tensor encoding.
+// -----------------------------------------------------------------------------
+//
+// Each board becomes ENCODE_PLANES planes of rows * cols f32 values:
+//
+//   ENCODE_OWN    stones of the side to move.
+//   ENCODE_OPP    stones of the other side.
+//   ENCODE_LEGAL  the cell a stone dropped in each column lands on.
+//   ENCODE_BLACK  all 1 if black is to move, all 0 otherwise.
+//
+// The side to move follows from the stone counts. Planes are stored column by
+// column, bottom row first, which is the order of the bitboards, so each
+// column expands from a few bits with one vector store per 8 rows.
+//
+// With mirroring, column c is encoded as column cols - 1 - c; a policy target
+// for the board must be mirrored the same way.
+
+#define ENCODE_OWN    0
+#define ENCODE_OPP    1
+#define ENCODE_LEGAL  2
+#define ENCODE_BLACK  3
+#define ENCODE_PLANES 4
+
+struct vm_t;
+
+// Returns the number of f32 values per board.
+static inline int
+encodeSize(const struct board_t *b)
+{
+        return ENCODE_PLANES * b->rows * b->cols;
+}
+
+// Encodes 'n' boards of the same geometry into 'dst', which holds
+// n * encodeSize() values. 'mirror' is NULL or one flag per board.
+extern void encodeBoards(struct board_t *const *boards, int n,
+                         const uint8_t *mirror, _out_ float *dst);
+
+// Same as encodeBoards, but writes into the f32 tensor 'td' of 'vm' with shape
+// [batch, encodeSize()]. Rows from 'n' to 'batch' are zeroed.
+extern error_t encodeBatch(struct vm_t *vm, int td,
+                           struct board_t *const *boards, int n,
+                           const uint8_t *mirror);
+
+#endif  // BB_ENCODE_H_
@@ -0,0 +1,268 @@
+#include "evcache.h"
+
+#include <math.h>    // lrintf
+#include <stdlib.h>  // calloc
+#include <string.h>  // memset
+
+#if defined(__SSE2__)
+#include <immintrin.h>  // _mm_pause
+#endif
+
+// bb
+#include "trace.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define MAX_SHARDS 64
+
+#define RELAXED memory_order_relaxed
+
+// bumps a shard counter. only the lock holder writes it, so no atomic add.
+#define COUNT(s, field)                                                  \
+        atomic_store_explicit(                                           \
+            &(s)->field, atomic_load_explicit(&(s)->field, RELAXED) + 1, \
+            RELAXED)
+
+_Static_assert(sizeof(struct evcache_entry_t) == 32, "8 entries per set.");
+_Static_assert(sizeof(struct evcache_set_t) == 4 * 64, "4 lines per set.");
+
+static void
+shardLock(struct evcache_shard_t *s)
+{
+        if (!atomic_exchange_explicit(&s->lock, 1, memory_order_acquire)) {
+                return;
+        }
+
+        TRACE_BEGIN(TRACE_LOCK_WAIT);
+        do {
+                while (atomic_load_explicit(&s->lock, RELAXED)) {
+#if defined(__SSE2__)
+                        _mm_pause();
+#endif
+                }
+        } while (atomic_exchange_explicit(&s->lock, 1, memory_order_acquire));
+        TRACE_END(TRACE_LOCK_WAIT);
+}
+
+static void
+shardUnlock(struct evcache_shard_t *s)
+{
+        atomic_store_explicit(&s->lock, 0, memory_order_release);
+}
+
+// returns the key of 'b' and sets 'mirrored' if it is the one of the mirror.
+static uint64_t
+cacheKey(const struct board_t *b, uint64_t salt, _out_ int *mirrored)
+{
+        const uint64_t h = boardHash(b);
+        const uint64_t m = boardHashMirror(b);
+
+        *mirrored          = m < h;
+        const uint64_t key = (*mirrored ? m : h) ^ salt;
+        return key != 0 ? key : 1;  // 0 marks empty entries.
+}
+
+// returns the set of 'key' and its shard in 's'.
+static struct evcache_set_t *
+cacheSet(struct evcache_t *c, uint64_t key, _out_ struct evcache_shard_t **s)
+{
+        *s = &c->shards[key & (c->num_shards - 1)];
+        return &(*s)->sets[(key / c->num_shards) & (c->sets_per_shard - 1)];
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+struct evcache_t *
+evcacheNew(size_t bytes)
+{
+        size_t num_sets = 1;
+        while (num_sets * 2 * sizeof(struct evcache_set_t) <= bytes) {
+                num_sets *= 2;
+        }
+
+        int num_shards = MAX_SHARDS;
+        while ((size_t)num_shards > num_sets) num_shards /= 2;
+
+        struct evcache_t *c = calloc(1, sizeof(*c));
+        c->num_shards       = num_shards;
+        c->sets_per_shard   = num_sets / num_shards;
+        c->bytes            = num_sets * sizeof(struct evcache_set_t);
+        c->sets             = aligned_alloc(64, c->bytes);
+        c->hands            = calloc(num_sets, sizeof(*c->hands));
+        c->shards = aligned_alloc(64, num_shards * sizeof(*c->shards));
+        if (c->sets == NULL || c->hands == NULL || c->shards == NULL) {
+                evcacheFree(c);
+                return NULL;
+        }
+
+        memset(c->sets, 0, c->bytes);
+        memset(c->shards, 0, num_shards * sizeof(*c->shards));
+        for (int i = 0; i < num_shards; i++) {
+                struct evcache_shard_t *s = &c->shards[i];
+                atomic_init(&s->lock, 0);
+                atomic_init(&s->probes, 0);
+                atomic_init(&s->hits, 0);
+                atomic_init(&s->stores, 0);
+                atomic_init(&s->evictions, 0);
+                s->sets  = &c->sets[i * c->sets_per_shard];
+                s->hands = &c->hands[i * c->sets_per_shard];
+        }
+        return c;
+}
+
+void
+evcacheFree(struct evcache_t *c)
+{
+        if (c == NULL) return;
+        free(c->shards);
+        free(c->sets);
+        free(c->hands);
+        free(c);
+}
+
+int
+evcacheGet(struct evcache_t *c, const struct board_t *b, uint64_t salt,
+           float *value, float *policy)
+{
+        int                     mirrored;
+        struct evcache_shard_t *s;
+        const uint64_t          key = cacheKey(b, salt, &mirrored);
+        struct evcache_set_t   *set = cacheSet(c, key, &s);
+        const int               cols = b->cols;
+
+        shardLock(s);
+        COUNT(s, probes);
+        for (int i = 0; i < EVCACHE_WAYS; i++) {
+                struct evcache_entry_t *e = &set->entries[i];
+                if (e->key != key) continue;
+                if (policy != NULL && !e->has_policy) break;
+
+                COUNT(s, hits);
+                e->ref = 1;
+                *value = e->value;
+                for (int col = 0; policy != NULL && col < cols; col++) {
+                        const int src = mirrored ? cols - 1 - col : col;
+                        policy[col]   = e->policy[src] / 255.0f;
+                }
+                shardUnlock(s);
+                return 1;
+        }
+        shardUnlock(s);
+        return 0;
+}
+
+void
+evcachePut(struct evcache_t *c, const struct board_t *b, uint64_t salt,
+           float value, const float *policy)
+{
+        int                     mirrored;
+        struct evcache_shard_t *s;
+        const uint64_t          key = cacheKey(b, salt, &mirrored);
+        struct evcache_set_t   *set = cacheSet(c, key, &s);
+        const int               cols = b->cols;
+
+        // quantized out of the lock.
+        uint8_t   q[EVCACHE_MAX_COLS] = {0};
+        const int has_policy = policy != NULL && cols <= EVCACHE_MAX_COLS;
+        for (int col = 0; has_policy && col < cols; col++) {
+                const float p = policy[col];
+                const int   dst = mirrored ? cols - 1 - col : col;
+                q[dst] = p <= 0 ? 0 : p >= 1 ? 255 : (uint8_t)lrintf(p * 255);
+        }
+
+        shardLock(s);
+        COUNT(s, stores);
+
+        // the same key first, then an empty entry, then the clock victim.
+        struct evcache_entry_t *e     = NULL;
+        struct evcache_entry_t *empty = NULL;
+        for (int i = 0; i < EVCACHE_WAYS; i++) {
+                struct evcache_entry_t *x = &set->entries[i];
+                if (x->key == key) {
+                        e = x;
+                        break;
+                }
+                if (x->key == 0 && empty == NULL) empty = x;
+        }
+        if (e == NULL) e = empty;
+        if (e == NULL) {
+                uint8_t *hand = &s->hands[set - s->sets];
+                while (set->entries[*hand].ref) {
+                        set->entries[*hand].ref = 0;
+                        *hand = (*hand + 1) % EVCACHE_WAYS;
+                }
+                e     = &set->entries[*hand];
+                *hand = (*hand + 1) % EVCACHE_WAYS;
+                COUNT(s, evictions);
+        }
+
+        e->key        = key;
+        e->value      = value;
+        e->ref        = 0;
+        e->has_policy = has_policy;
+        memcpy(e->policy, q, sizeof(q));
+        shardUnlock(s);
+}
+
+void
+evcacheStats(struct evcache_t *c, struct evcache_stats_t *stats)
+{
+        memset(stats, 0, sizeof(*stats));
+        for (int i = 0; i < c->num_shards; i++) {
+                struct evcache_shard_t *s = &c->shards[i];
+                stats->probes += atomic_load_explicit(&s->probes, RELAXED);
+                stats->hits += atomic_load_explicit(&s->hits, RELAXED);
+                stats->stores += atomic_load_explicit(&s->stores, RELAXED);
+                stats->evictions +=
+                    atomic_load_explicit(&s->evictions, RELAXED);
+        }
+        if (stats->probes > 0) {
+                stats->hit_rate = (double)stats->hits / stats->probes;
+        }
+}
+
+error_t
+evcacheEval(void *ctx, struct board_t *const *boards, int n, float *policy,
+            float *value)
+{
+        struct evcache_eval_t *f = ctx;
+        if (n == 0) return OK;
+
+        const int cols = boards[0]->cols;
+        if (cols > EVCACHE_MAX_COLS) {
+                return f->eval(f->ctx, boards, n, policy, value);
+        }
+
+        struct board_t *miss[n];
+        int             miss_idx[n];
+        float           miss_policy[n * cols];
+        float           miss_value[n];
+        int             m = 0;
+
+        for (int i = 0; i < n; i++) {
+                if (evcacheGet(f->cache, boards[i], f->salt, &value[i],
+                               policy + i * cols)) {
+                        continue;
+                }
+                miss[m]       = boards[i];
+                miss_idx[m++] = i;
+        }
+        if (m == 0) return OK;
+
+        error_t err = f->eval(f->ctx, miss, m, miss_policy, miss_value);
+        if (err) return err;
+
+        for (int j = 0; j < m; j++) {
+                const int i = miss_idx[j];
+                memcpy(policy + i * cols, miss_policy + j * cols,
+                       cols * sizeof(float));
+                value[i] = miss_value[j];
+                evcachePut(f->cache, miss[j], f->salt, miss_value[j],
+                           miss_policy + j * cols);
+        }
+        return OK;
+}
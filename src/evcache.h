@@ -0,0 +1,123 @@
+#ifndef BB_EVCACHE_H_
+#define BB_EVCACHE_H_
+
+#include <stdatomic.h>
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+
+// bb
+#include "board.h"
+#include "puct.h"
+
+// -----------------------------------------------------------------------------
+// Evaluation cache.
+// -----------------------------------------------------------------------------
+//
+// A fixed-size cache of position evaluations: a value and, optionally, a
+// policy over the columns quantized to one byte each. It is shared by all
+// searches, so it is split into shards, each with its own spin lock.
+//
+// Positions are keyed by min(boardHash, boardHashMirror), so a position and
+// its mirror share one entry; a policy is stored in the orientation of the
+// smaller hash and mirrored back on the way out.
+//
+// Each shard counts its own probes and stores. The counters are only written
+// under the shard lock but are atomic, so evcacheStats reads them without
+// taking any lock.
+//
+// Entries sit in sets of EVCACHE_WAYS. A hit sets the entry's reference bit.
+// A miss in a full set evicts with the clock algorithm: the set's hand clears
+// reference bits until it finds an entry without one.
+//
+// Evaluators sharing a cache keep their entries apart with distinct 'salt's,
+// which are xor-ed into the keys.
+
+#define EVCACHE_WAYS     8
+#define EVCACHE_MAX_COLS 16
+
+// Salts of the evaluators in src/.
+#define EVCACHE_SALT_AB 0x5bd1e9955bd1e995ULL
+#define EVCACHE_SALT_NN 0xc2b2ae3d27d4eb4fULL
+
+struct evcache_entry_t {
+        uint64_t key;  // 0 => empty.
+        float    value;
+        uint8_t  ref;         // clock reference bit.
+        uint8_t  has_policy;  //
+        uint8_t  policy[EVCACHE_MAX_COLS];  // in 1/255.
+};
+
+struct evcache_set_t {
+        struct evcache_entry_t entries[EVCACHE_WAYS];
+} __attribute__((aligned(64)));
+
+struct evcache_shard_t {
+        atomic_int            lock;
+        struct evcache_set_t *sets;   // unowned. slice of the cache's sets.
+        uint8_t              *hands;  // unowned. clock hand per set.
+
+        // written under the lock. read by evcacheStats without it.
+        _Atomic(uint64_t) probes;
+        _Atomic(uint64_t) hits;
+        _Atomic(uint64_t) stores;
+        _Atomic(uint64_t) evictions;
+} __attribute__((aligned(64)));
+
+struct evcache_stats_t {
+        uint64_t probes;
+        uint64_t hits;
+        uint64_t stores;
+        uint64_t evictions;  // stores replacing an entry of another key.
+        double   hit_rate;   // hits / probes. 0 without probes.
+};
+
+struct evcache_t {
+        struct evcache_shard_t *shards;  // owned.
+        struct evcache_set_t   *sets;    // owned.
+        uint8_t                *hands;   // owned.
+        int                     num_shards;      // power of 2.
+        size_t                  sets_per_shard;  // power of 2.
+        size_t                  bytes;           // allocated bytes.
+};
+
+// Front of a puct_eval_fn: see evcacheEval.
+struct evcache_eval_t {
+        struct evcache_t *cache;  // unowned.
+        puct_eval_fn      eval;
+        void             *ctx;  // passed to eval.
+        uint64_t          salt;
+};
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+// Allocates a cache of at most 'bytes', rounded down to a power of 2 sets.
+extern struct evcache_t *evcacheNew(size_t bytes);
+extern void              evcacheFree(struct evcache_t *c);
+
+// Returns 1 and fills 'value' and, if not NULL, 'policy' of b->cols entries if
+// 'b' is cached; 0 otherwise. With 'policy', entries stored without one miss.
+extern int evcacheGet(struct evcache_t *c, const struct board_t *b,
+                      uint64_t salt, _out_ float *value, _out_ float *policy);
+
+// Stores 'value' and 'policy', NULL-able, of b->cols entries for 'b'. Boards
+// wider than EVCACHE_MAX_COLS store no policy.
+extern void evcachePut(struct evcache_t *c, const struct board_t *b,
+                       uint64_t salt, float value, const float *policy);
+
+// Sums the counters of all shards. Lock-free; with concurrent searches, the
+// sum is not a snapshot of one instant.
+extern void evcacheStats(struct evcache_t *c,
+                         _out_ struct evcache_stats_t *stats);
+
+// A puct_eval_fn with 'ctx' as an evcache_eval_t: positions found in the cache
+// are answered from it and the others are passed on to 'eval' in one call,
+// then stored.
+extern error_t evcacheEval(void *ctx, struct board_t *const *boards, int n,
+                           _out_ float *policy, _out_ float *value);
+
+#endif  // BB_EVCACHE_H_
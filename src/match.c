@@ -0,0 +1,291 @@
+#include "match.h"
+
+#include <stdlib.h>  // malloc
+#include <string.h>  // memset
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+// ranks the PNS_* results, for the same player. -1 if unknown.
+static int
+rankOf(int result)
+{
+        switch (result) {
+        case PNS_WIN: return 2;
+        case PNS_DRAW: return 1;
+        case PNS_LOSS: return 0;
+        default: return -1;
+        }
+}
+
+// solves 'b' with 'next' to play; returns the rank of the result for 'color'.
+static error_t
+solveRank(const struct match_opts_t *opts, struct board_t *b,
+          enum player_t next, enum player_t color, _out_ int *rank)
+{
+        int     result, col;
+        error_t err = pnsSolve(opts->solver, b, next, opts->solve_nodes,
+                               &result, &col);
+        if (err) return errEmitNote("failed to solve the position.");
+
+        *rank = rankOf(result);
+        if (*rank != -1 && next != color) *rank = 2 - *rank;
+        return OK;
+}
+
+static void
+totalsAddMove(struct match_totals_t *t, const struct bot_stats_t *s)
+{
+        t->moves++;
+        t->forced += s->forced != 0;
+        t->nodes += s->nodes;
+        t->playouts += s->playouts;
+        t->tt_probes += s->tt_probes;
+        t->tt_hits += s->tt_hits;
+        t->wall_ns += s->wall_ns;
+        if (s->wall_ns > t->max_wall_ns) t->max_wall_ns = s->wall_ns;
+        if (s->max_depth > t->max_depth) t->max_depth = s->max_depth;
+}
+
+static void
+totalsAdd(struct match_totals_t *t, const struct match_totals_t *o)
+{
+        t->moves += o->moves;
+        t->forced += o->forced;
+        t->nodes += o->nodes;
+        t->playouts += o->playouts;
+        t->tt_probes += o->tt_probes;
+        t->tt_hits += o->tt_hits;
+        t->wall_ns += o->wall_ns;
+        t->solved += o->solved;
+        t->blunders += o->blunders;
+        if (o->max_wall_ns > t->max_wall_ns) t->max_wall_ns = o->max_wall_ns;
+        if (o->max_depth > t->max_depth) t->max_depth = o->max_depth;
+}
+
+// plays one game. bots[0] is black. 'ids' are the record ids of the bots, by
+// bot index.
+static error_t
+playGame(const struct match_opts_t *opts, struct bot_t *bots[2],
+         const int idx[2], const int ids[2], struct match_game_t *g)
+{
+        struct board_t *b = boardNew(opts->rows, opts->cols, opts->num_to_win,
+                                     /*mode=*/1);
+        uint8_t        *moves = malloc(opts->rows * opts->cols);
+        error_t         err   = OK;
+
+        enum player_t color    = PLAYER_BLACK;
+        int           prev_row = -1;
+        int           prev_col = -1;
+
+        g->winner = PLAYER_NA;
+        while (g->winner == PLAYER_NA) {
+                const int     side = color == PLAYER_BLACK ? 0 : 1;
+                struct bot_t *bot  = bots[side];
+
+                // the exact result before the move, if a solver is given.
+                int before = -1;
+                if (opts->solver != NULL) {
+                        err = solveRank(opts, b, color, color, &before);
+                        if (err) goto exit;
+                }
+
+                int r, c;
+                err = botPlay(bot, b, prev_row, prev_col, &r, &c);
+                if (err) {
+                        err = errEmitNote("bot %s failed.", bot->name);
+                        goto exit;
+                }
+                if (c < 0 || c >= b->cols || boardRowForCol(b, c) != r) {
+                        err = errNew("bot %s played an illegal move: (%d, %d)",
+                                     bot->name, r, c);
+                        goto exit;
+                }
+
+                boardSet(b, r, c, color, 0);
+                totalsAddMove(&g->totals[idx[side]], &bot->stats);
+                moves[g->num_moves++] = c;
+                g->winner = boardWinnerAt(b, r, c);
+
+                if (before != -1) {
+                        int after = g->winner == color        ? 2
+                                    : g->winner == PLAYER_TIE ? 1
+                                                              : -1;
+                        if (g->winner == PLAYER_NA) {
+                                err = solveRank(opts, b, NEXT_PLAYER(color),
+                                                color, &after);
+                                if (err) goto exit;
+                        }
+                        if (after != -1) {
+                                g->totals[idx[side]].solved++;
+                                g->totals[idx[side]].blunders +=
+                                    after < before;
+                        }
+                }
+
+                prev_row = r;
+                prev_col = c;
+                color    = NEXT_PLAYER(color);
+        }
+
+        if (opts->records != NULL) {
+                err = recordWrite(opts->records, ids[idx[0]], ids[idx[1]],
+                                  g->winner, moves, g->num_moves);
+                if (err) err = errEmitNote("failed to record the game.");
+        }
+
+exit:
+        free(moves);
+        boardFree(b);
+        return err;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+void
+matchRecordHeader(const struct match_opts_t *opts, struct record_header_t *h)
+{
+        h->rows       = opts->rows;
+        h->cols       = opts->cols;
+        h->num_to_win = opts->num_to_win;
+}
+
+error_t
+matchPlay(const struct match_opts_t *opts, struct bot_t *bot0,
+          struct bot_t *bot1, struct match_report_t *report)
+{
+        memset(report, 0, sizeof(*report));
+
+        int ids[2] = {-1, -1};
+        if (opts->records != NULL) {
+                const struct record_header_t *h = &opts->records->header;
+                if (h->rows != opts->rows || h->cols != opts->cols ||
+                    h->num_to_win != opts->num_to_win) {
+                        return errNew("records are %dx%d (%d), games are "
+                                      "%dx%d (%d).",
+                                      h->rows, h->cols, h->num_to_win,
+                                      opts->rows, opts->cols,
+                                      opts->num_to_win);
+                }
+
+                error_t err = recordWriterBot(opts->records, bot0->name,
+                                              &ids[0]);
+                if (!err) {
+                        err = recordWriterBot(opts->records, bot1->name,
+                                              &ids[1]);
+                }
+                if (err) return errEmitNote("failed to record the bots.");
+        }
+
+        for (int i = 0; i < opts->games; i++) {
+                // bot 'black' plays black.
+                const int black = opts->swap ? i % 2 : 0;
+                const int idx[2] = {black, 1 - black};
+
+                struct bot_t *all[2]  = {bot0, bot1};
+                struct bot_t *bots[2] = {all[idx[0]], all[idx[1]]};
+
+                struct match_game_t g;
+                memset(&g, 0, sizeof(g));
+                g.index = i;
+                g.black = black;
+
+                error_t err = playGame(opts, bots, idx, ids, &g);
+                if (err) return errEmitNote("game %d failed.", i);
+
+                report->games++;
+                if (g.winner == PLAYER_TIE) {
+                        report->draws++;
+                } else {
+                        report->wins[g.winner == PLAYER_BLACK ? idx[0]
+                                                              : idx[1]]++;
+                }
+                totalsAdd(&report->totals[0], &g.totals[0]);
+                totalsAdd(&report->totals[1], &g.totals[1]);
+
+                if (opts->on_game != NULL) opts->on_game(&g, opts->ctx);
+        }
+
+        if (opts->eval_cache != NULL) {
+                report->has_cache = 1;
+                evcacheStats(opts->eval_cache, &report->cache);
+        }
+        return OK;
+}
+
+void
+matchTotalsSummary(const struct match_totals_t *t, sds_t *str)
+{
+        const double moves = t->moves > 0 ? t->moves : 1;
+        const double secs  = t->wall_ns / 1e9;
+
+        sdsCatPrintf(str, "%d moves", t->moves);
+        if (t->forced > 0) sdsCatPrintf(str, " (%d forced)", t->forced);
+        if (t->nodes > 0) {
+                sdsCatPrintf(str, ", %.0f nodes/move, %.0f nodes/s",
+                             t->nodes / moves,
+                             secs > 0 ? t->nodes / secs : 0);
+        }
+        if (t->playouts > 0) {
+                sdsCatPrintf(str, ", %.0f playouts/move", t->playouts / moves);
+        }
+        if (t->max_depth > 0) sdsCatPrintf(str, ", max depth %d", t->max_depth);
+        if (t->tt_probes > 0) {
+                sdsCatPrintf(str, ", tt %.1f%%",
+                             100.0 * t->tt_hits / t->tt_probes);
+        }
+        if (t->solved > 0) {
+                sdsCatPrintf(str, ", %d blunders in %d solved moves",
+                             t->blunders, t->solved);
+        }
+        sdsCatPrintf(str, ", %.2f ms/move (max %.2f)", t->wall_ns / 1e6 / moves,
+                     t->max_wall_ns / 1e6);
+}
+
+void
+matchGameSummary(const struct match_game_t *g, struct bot_t *bot0,
+                 struct bot_t *bot1, sds_t *str)
+{
+        struct bot_t *bots[2] = {bot0, bot1};
+        const char   *winner  = g->winner == PLAYER_TIE ? "tie"
+                                : g->winner == PLAYER_BLACK
+                                    ? bots[g->black]->name
+                                    : bots[1 - g->black]->name;
+
+        sdsCatPrintf(str, "game %d: %s (black) vs %s (white), %d moves, "
+                     "winner: %s\n",
+                     g->index, bots[g->black]->name,
+                     bots[1 - g->black]->name, g->num_moves, winner);
+        for (int i = 0; i < 2; i++) {
+                sdsCatPrintf(str, "  %s: ", bots[i]->name);
+                matchTotalsSummary(&g->totals[i], str);
+                sdsCatPrintf(str, "\n");
+        }
+}
+
+void
+matchReportSummary(const struct match_report_t *r, struct bot_t *bot0,
+                   struct bot_t *bot1, sds_t *str)
+{
+        struct bot_t *bots[2] = {bot0, bot1};
+
+        sdsCatPrintf(str, "match: %d games, %s %d - %d %s, %d draws\n",
+                     r->games, bot0->name, r->wins[0], r->wins[1], bot1->name,
+                     r->draws);
+        for (int i = 0; i < 2; i++) {
+                sdsCatPrintf(str, "  %s: ", bots[i]->name);
+                matchTotalsSummary(&r->totals[i], str);
+                sdsCatPrintf(str, "\n");
+        }
+        if (r->has_cache) {
+                sdsCatPrintf(str, "  eval cache: %.1f%% hits of %llu probes, "
+                             "%llu stores, %llu evictions\n",
+                             100.0 * r->cache.hit_rate,
+                             (unsigned long long)r->cache.probes,
+                             (unsigned long long)r->cache.stores,
+                             (unsigned long long)r->cache.evictions);
+        }
+}
@@ -0,0 +1,117 @@
+#ifndef BB_MATCH_H_
+#define BB_MATCH_H_
+
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <adt/sds.h>
+#include <base/error.h>
+
+// bb
+#include "board.h"
+#include "bot.h"
+#include "evcache.h"
+#include "pns.h"
+#include "record.h"
+
+// -----------------------------------------------------------------------------
+// Headless matches.
+// -----------------------------------------------------------------------------
+//
+// Plays games between two bots without any UI and aggregates the bot stats of
+// every move into per-game and per-match reports.
+
+// Totals of struct bot_stats_t over the moves of one bot.
+struct match_totals_t {
+        int      moves;
+        int      forced;  // moves by the threat-space search.
+        int      max_depth;
+        uint64_t nodes;
+        uint64_t playouts;
+        uint64_t tt_probes;
+        uint64_t tt_hits;
+        uint64_t wall_ns;
+        uint64_t max_wall_ns;  // of the slowest move.
+
+        // with a solver: moves whose position was solved before and after,
+        // and those among them turning a win into a draw or a loss, or a
+        // draw into a loss.
+        int solved;
+        int blunders;
+};
+
+struct match_game_t {
+        int           index;      // 0-based.
+        int           black;      // bot index (0 or 1) playing black.
+        enum player_t winner;     // PLAYER_BLACK, PLAYER_WHITE or PLAYER_TIE.
+        int           num_moves;  // stones placed.
+
+        struct match_totals_t totals[2];  // per bot index.
+};
+
+struct match_report_t {
+        int games;
+        int wins[2];  // per bot index.
+        int draws;
+
+        struct match_totals_t totals[2];  // per bot index.
+
+        // of the evaluation cache of the options at the end of the match, if
+        // any. 'has_cache' is 0 without one.
+        int                    has_cache;
+        struct evcache_stats_t cache;
+};
+
+struct match_opts_t {
+        int rows;
+        int cols;
+        int num_to_win;
+        int games;
+        int swap;  // 1 to alternate colors; bot 0 plays black first.
+
+        // called after each game if not NULL.
+        void (*on_game)(const struct match_game_t *, void *ctx);
+        void *ctx;
+
+        // if not NULL, games are appended, with the bots declared by name
+        // (see recordWriterBot), so their ids hold across runs. its header
+        // must be the one of matchRecordHeader. not owned.
+        struct record_writer_t *records;
+
+        // if not NULL, every move is checked against the exact results of the
+        // positions before and after it, each solved within 'solve_nodes'
+        // nodes (0 => unlimited). moves with an unknown result are skipped.
+        // not owned.
+        struct pns_t *solver;
+        uint64_t      solve_nodes;
+
+        // the evaluation cache shared by the bots (see bot_opts_t), if any,
+        // only to report its counters. not owned.
+        struct evcache_t *eval_cache;
+};
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+// Fills 'h' with the record header of the games of 'opts'.
+extern void matchRecordHeader(const struct match_opts_t *opts,
+                              _out_ struct record_header_t *h);
+
+// Plays 'opts->games' games between 'bot0' and 'bot1' and fills 'report'.
+// Fails if the records have another geometry.
+extern error_t matchPlay(const struct match_opts_t *opts, struct bot_t *bot0,
+                         struct bot_t *bot1,
+                         _out_ struct match_report_t *report);
+
+// Appends a one-line summary of 't' to 'str'.
+extern void matchTotalsSummary(const struct match_totals_t *t, sds_t *str);
+
+// Append reports to 'str': one line for the result and one per bot.
+extern void matchGameSummary(const struct match_game_t *g, struct bot_t *bot0,
+                             struct bot_t *bot1, sds_t *str);
+extern void matchReportSummary(const struct match_report_t *r,
+                               struct bot_t *bot0, struct bot_t *bot1,
+                               sds_t *str);
+
+#endif  // BB_MATCH_H_
@@ -0,0 +1,545 @@
+#include "mcts.h"
+
+#include <assert.h>
+#include <math.h>    // sqrtf, logf
+#include <stdlib.h>  // malloc
+#include <string.h>  // memset
+
+// eva
+#include <rng/srng64.h>
+
+// bb
+#include "trace.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define DEFAULT_PLAYOUTS 10000
+#define DEFAULT_NODES    100000
+#define DEFAULT_C_UCT    1.4f
+#define DEFAULT_RAVE_K   50.0f
+
+_Static_assert(sizeof(struct mcts_edge_t) == 16, "4 edges per cache line.");
+
+// result of a finished game for player 'p'.
+#define REWARD(w, p) ((w) == (p) ? 1.0f : ((w) == PLAYER_TIE ? 0.5f : 0.0f))
+
+// returns the node index for 'hash', or -1 if absent.
+static int32_t
+indexFind(struct mcts_t *m, uint64_t hash)
+{
+        size_t i = hash & m->index_mask;
+        while (m->index[i] != -1) {
+                if (m->nodes[m->index[i]].hash == hash) return m->index[i];
+                i = (i + 1) & m->index_mask;
+        }
+        return -1;
+}
+
+static void
+indexInsert(struct mcts_t *m, uint64_t hash, int32_t node)
+{
+        size_t i = hash & m->index_mask;
+        while (m->index[i] != -1) i = (i + 1) & m->index_mask;
+        m->index[i] = node;
+}
+
+// returns the new node index, or -1 if the arena is full.
+//
+// 'mover' is the player moving into the node. A finished game is a proven win
+// for the mover unless tied; otherwise, a proof may come from the table.
+static int32_t
+nodeNew(struct mcts_t *m, uint64_t hash, enum player_t mover,
+        enum player_t winner)
+{
+        if (m->num_nodes == m->opts.nodes) return -1;
+
+        int32_t             idx = m->num_nodes++;
+        struct mcts_node_t *n   = &m->nodes[idx];
+        n->hash                 = hash;
+        n->first_edge           = -1;
+        n->num_edges            = 0;
+        n->winner               = winner;
+        n->proven               = MCTS_PROVEN_NONE;
+        n->plies                = 0;
+        n->visits               = 0;
+        n->value                = 0;
+
+        struct tt_data_t data;
+        if (winner == mover) {
+                n->proven = MCTS_PROVEN_WIN;
+        } else if (winner == PLAYER_NA && m->tt != NULL &&
+                   ttProbe(m->tt, hash, &data, &m->tt_stats) &&
+                   data.flag == TT_FLAG_EXACT &&
+                   data.depth == TT_DEPTH_SOLVED && data.value != 0) {
+                // the table value is for the side to move, i.e., not mover.
+                n->proven =
+                    data.value > 0 ? MCTS_PROVEN_LOSS : MCTS_PROVEN_WIN;
+                n->plies = TT_SCORE_WIN - abs(data.value);
+        }
+
+        indexInsert(m, hash, idx);
+        return idx;
+}
+
+// applies the minimax rules to an expanded node: it is lost for the mover if
+// any child is won by the opponent, and won if all children are lost by the
+// opponent. returns 1 if the node becomes proven.
+static int
+nodeProve(struct mcts_t *m, struct mcts_node_t *n)
+{
+        if (n->proven != MCTS_PROVEN_NONE || n->first_edge == -1) return 0;
+
+        // plies to the end: the shortest win through a child won by the
+        // opponent, or the longest loss if all are lost by the opponent.
+        int all_lost  = 1;
+        int win_plies = INT16_MAX;
+        int max_plies = 0;
+        for (int i = 0; i < n->num_edges; i++) {
+                int32_t child = m->edges[n->first_edge + i].child;
+                if (child == -1) {
+                        all_lost = 0;
+                        continue;
+                }
+
+                const struct mcts_node_t *c = &m->nodes[child];
+                if (c->proven == MCTS_PROVEN_WIN) {
+                        n->proven = MCTS_PROVEN_LOSS;
+                        if (c->plies < win_plies) win_plies = c->plies;
+                }
+                if (c->proven != MCTS_PROVEN_LOSS) all_lost = 0;
+                if (c->plies > max_plies) max_plies = c->plies;
+        }
+        if (n->proven == MCTS_PROVEN_LOSS) {
+                n->plies = win_plies + 1;
+        } else if (all_lost) {
+                n->proven = MCTS_PROVEN_WIN;
+                n->plies  = max_plies + 1;
+        } else {
+                return 0;
+        }
+
+        if (m->tt != NULL) {
+                // for the side to move, i.e., not the mover.
+                const int        score = TT_SCORE_WIN - n->plies;
+                struct tt_data_t data  = {
+                    .value = n->proven == MCTS_PROVEN_LOSS ? score : -score,
+                    .depth = TT_DEPTH_SOLVED,
+                    .flag  = TT_FLAG_EXACT,
+                    .move  = TT_NO_MOVE,
+                };
+                ttStore(m->tt, n->hash, &data, &m->tt_stats);
+        }
+        return 1;
+}
+
+// creates one edge per legal column. returns -1 if the edge arena is full.
+static int
+nodeExpand(struct mcts_t *m, struct mcts_node_t *n, struct board_t *b)
+{
+        const int cols = b->cols;
+        if (m->num_edges + cols > m->cap_edges) return -1;
+
+        n->first_edge = m->num_edges;
+        for (int col = 0; col < cols; col++) {
+                if (boardRowForCol(b, col) == -1) continue;
+
+                struct mcts_edge_t *e = &m->edges[m->num_edges++];
+                e->child              = -1;
+                e->visits             = 0;
+                e->amaf_value         = 0;
+                e->amaf_visits        = 0;
+                e->col                = col;
+                n->num_edges++;
+        }
+        return 0;
+}
+
+#define CHILD_PROVEN(m, e) \
+        ((e)->child == -1 ? MCTS_PROVEN_NONE : (m)->nodes[(e)->child].proven)
+
+// picks an unvisited edge at random if any; otherwise the best UCT score.
+// edges proven lost for the mover are skipped. returns NULL if all are.
+static struct mcts_edge_t *
+edgeSelect(struct mcts_t *m, struct mcts_node_t *n)
+{
+        struct mcts_edge_t *edges = &m->edges[n->first_edge];
+        const int           count = n->num_edges;
+
+        int offset = rng64NextUint64(m->rng) % count;
+        for (int i = 0; i < count; i++) {
+                struct mcts_edge_t *e = &edges[(offset + i) % count];
+                if (e->visits == 0 && CHILD_PROVEN(m, e) != MCTS_PROVEN_LOSS) {
+                        return e;
+                }
+        }
+
+        const float log_n = logf((float)n->visits);
+
+        struct mcts_edge_t *best       = NULL;
+        float               best_score = -1;
+        for (int i = 0; i < count; i++) {
+                struct mcts_edge_t *e = &edges[i];
+                if (CHILD_PROVEN(m, e) == MCTS_PROVEN_LOSS) continue;
+
+                // the child value aggregates all parents; an edge without a
+                // child (arena full) only has its own visits to go with.
+                float q = 0.5f;
+                if (e->child != -1) {
+                        struct mcts_node_t *c = &m->nodes[e->child];
+                        if (c->visits > 0) q = c->value / c->visits;
+                }
+
+                if (m->opts.rave && e->amaf_visits > 0) {
+                        const float k    = m->opts.rave_k;
+                        float       beta = sqrtf(k / (3 * e->visits + k));
+                        float       amaf_q = e->amaf_value / e->amaf_visits;
+                        q = (1 - beta) * q + beta * amaf_q;
+                }
+
+                float score =
+                    q + m->opts.c_uct * sqrtf(log_n / (float)e->visits);
+                if (score > best_score) {
+                        best       = e;
+                        best_score = score;
+                }
+        }
+        return best;
+}
+
+// AMAF backup of one playout. 'moves' holds all columns played from the root,
+// in the tree and then in the playout; the player of moves[j] is the player
+// to move at depth j. Walking backwards, 'played' collects the columns played
+// at or after depth i by each side, so node i updates its edges in one pass.
+static void
+raveBackup(struct mcts_t *m, const int32_t *path_nodes, int depth,
+           const uint8_t *moves, int num_moves, enum player_t next,
+           enum player_t w)
+{
+        uint64_t played[2][BITSET_MAX_WORDS] = {{0}};  // cols < 256.
+
+        for (int j = num_moves - 1; j >= 0; j--) {
+                bitsetSet(played[j & 1], moves[j]);
+                if (j > depth || path_nodes[j] == -1) continue;
+
+                struct mcts_node_t *n = &m->nodes[path_nodes[j]];
+                if (n->first_edge == -1) continue;
+
+                enum player_t to_move = (j & 1) ? NEXT_PLAYER(next) : next;
+                float         reward  = REWARD(w, to_move);
+                for (int i = 0; i < n->num_edges; i++) {
+                        struct mcts_edge_t *e = &m->edges[n->first_edge + i];
+                        if (!bitsetTest(played[j & 1], e->col)) continue;
+
+                        if (e->amaf_visits == UINT16_MAX) {
+                                e->amaf_visits /= 2;
+                                e->amaf_value /= 2;
+                        }
+                        e->amaf_visits++;
+                        e->amaf_value += reward;
+                }
+        }
+}
+
+// resets the arenas and makes sure they fit the board.
+static error_t
+searchReset(struct mcts_t *m, struct board_t *b)
+{
+        if (b->cols > UINT8_MAX) {
+                return errNew("too many columns for mcts: %d", b->cols);
+        }
+
+        if (m->scratch == NULL || m->scratch->rows != b->rows ||
+            m->scratch->cols != b->cols) {
+                boardFree(m->scratch);
+                free(m->moves);
+                m->scratch = boardClone(b);
+                m->moves   = malloc(b->rows * b->cols * sizeof(*m->moves));
+        }
+
+        const int cap_edges = m->opts.nodes * b->cols;
+        if (m->cap_edges < cap_edges) {
+                free(m->edges);
+                m->edges     = malloc(cap_edges * sizeof(*m->edges));
+                m->cap_edges = cap_edges;
+                if (m->edges == NULL) {
+                        m->cap_edges = 0;
+                        return errNew("failed to allocate %d edges.",
+                                      cap_edges);
+                }
+        }
+
+        m->num_nodes = 0;
+        m->num_edges = 0;
+        memset(m->index, 0xff, (m->index_mask + 1) * sizeof(*m->index));
+        return OK;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+struct mcts_t *
+mctsNew(const struct mcts_opts_t *opts, uint64_t seed, struct tt_t *tt)
+{
+        struct mcts_t *m = calloc(1, sizeof(*m));
+        m->opts          = *opts;
+        if (m->opts.playouts <= 0) m->opts.playouts = DEFAULT_PLAYOUTS;
+        if (m->opts.nodes <= 0) m->opts.nodes = DEFAULT_NODES;
+        if (m->opts.c_uct <= 0) m->opts.c_uct = DEFAULT_C_UCT;
+        if (m->opts.rave_k <= 0) m->opts.rave_k = DEFAULT_RAVE_K;
+
+        m->rng   = srng64New(seed);
+        m->tt    = tt;
+        m->nodes = malloc(m->opts.nodes * sizeof(*m->nodes));
+
+        // keep the load factor at most 1/2.
+        size_t index_size = 1;
+        while (index_size < 2 * (size_t)m->opts.nodes) index_size *= 2;
+        m->index      = malloc(index_size * sizeof(*m->index));
+        m->index_mask = index_size - 1;
+
+        return m;
+}
+
+void
+mctsFree(struct mcts_t *m)
+{
+        if (m == NULL) return;
+        rng64Free(m->rng);
+        boardFree(m->scratch);
+        free(m->moves);
+        free(m->nodes);
+        free(m->edges);
+        free(m->index);
+        free(m);
+}
+
+error_t
+mctsSearch(struct mcts_t *m, struct board_t *b, enum player_t next, int *col)
+{
+        if (boardWinner(b) != PLAYER_NA) return errNew("game is over.");
+
+        error_t err = searchReset(m, b);
+        if (err) return err;
+
+        struct board_t *scratch = m->scratch;
+        memset(&m->tt_stats, 0, sizeof(m->tt_stats));
+
+        // the path of a playout: path_nodes[i] is reached by path_edges[i].
+        const int           max_depth = b->rows * b->cols + 1;
+        int32_t             path_nodes[max_depth];
+        struct mcts_edge_t *path_edges[max_depth];
+
+        const int32_t root =
+            nodeNew(m, boardHash(b), NEXT_PLAYER(next), PLAYER_NA);
+        assert(root == 0);
+
+        // the root must be searched to find the move, so a proof from the
+        // table is dropped.
+        m->nodes[root].proven = MCTS_PROVEN_NONE;
+
+        m->max_depth = 0;
+
+        TRACE_BEGIN(TRACE_SEARCH);
+
+        int it;
+        for (it = 0; it < m->opts.playouts; it++) {
+                // a proven root needs no more search.
+                if (m->nodes[root].proven != MCTS_PROVEN_NONE) break;
+
+                boardCopy(scratch, b);
+
+                enum player_t to_move = next;
+                enum player_t w       = PLAYER_NA;
+                int           depth   = 0;
+                int32_t       cur     = root;
+
+                path_nodes[0] = root;
+
+                // selection and expansion. stops at a new node, a finished
+                // game, a proven node or when the arenas are full.
+                TRACE_BEGIN(TRACE_SELECT);
+                while (1) {
+                        struct mcts_node_t *n = &m->nodes[cur];
+                        if (n->winner != PLAYER_NA) {
+                                w = n->winner;
+                                break;
+                        }
+                        if (n->proven != MCTS_PROVEN_NONE) {
+                                w = n->proven == MCTS_PROVEN_WIN
+                                        ? NEXT_PLAYER(to_move)
+                                        : to_move;
+                                break;
+                        }
+
+                        if (n->first_edge == -1) {
+                                TRACE_BEGIN(TRACE_EXPAND);
+                                int full = nodeExpand(m, n, scratch) != 0;
+                                TRACE_END(TRACE_EXPAND);
+                                if (full) break;
+                        }
+
+                        struct mcts_edge_t *e = edgeSelect(m, n);
+                        if (e == NULL) {
+                                // all children were proven lost through
+                                // other parents. prove it and stop above.
+                                nodeProve(m, n);
+                                continue;
+                        }
+
+                        int row = boardRowForCol(scratch, e->col);
+                        boardSet(scratch, row, e->col, to_move, 0);
+                        w       = boardWinnerAt(scratch, row, e->col);
+                        to_move = NEXT_PLAYER(to_move);
+
+                        depth++;
+                        path_edges[depth] = e;
+                        if (depth > m->max_depth) m->max_depth = depth;
+
+                        int is_new = 0;
+                        if (e->child == -1) {
+                                // a transposition shares the existing node.
+                                uint64_t hash = boardHash(scratch);
+                                e->child      = indexFind(m, hash);
+                                if (e->child == -1) {
+                                        e->child = nodeNew(
+                                            m, hash, NEXT_PLAYER(to_move), w);
+                                        is_new = 1;
+                                }
+                        }
+
+                        path_nodes[depth] = e->child;
+                        if (e->child == -1 || is_new) break;
+                        cur = e->child;
+                }
+                TRACE_END(TRACE_SELECT);
+
+                // simulation. with RAVE, the playout appends its columns to
+                // the ones played in the tree.
+                const int rave      = m->opts.rave;
+                int       num_moves = depth;
+                if (rave) {
+                        for (int i = 1; i <= depth; i++) {
+                                m->moves[i - 1] = path_edges[i]->col;
+                        }
+                }
+                if (w == PLAYER_NA) {
+                        uint8_t *moves = rave ? m->moves + depth : NULL;
+                        int      n     = 0;
+                        TRACE_BEGIN(TRACE_PLAYOUT);
+                        w = boardPlayout(scratch, to_move, m->rng, moves, &n);
+                        TRACE_END(TRACE_PLAYOUT);
+                        num_moves += n;
+                }
+                TRACE_BEGIN(TRACE_BACKUP);
+                if (rave) {
+                        raveBackup(m, path_nodes, depth, m->moves, num_moves,
+                                   next, w);
+                }
+
+                // backup. the mover into path_nodes[i] is the player to move
+                // at depth i - 1.
+                m->nodes[root].visits++;
+                enum player_t mover = next;
+                for (int i = 1; i <= depth; i++) {
+                        path_edges[i]->visits++;
+                        int32_t idx = path_nodes[i];
+                        if (idx != -1) {
+                                m->nodes[idx].visits++;
+                                m->nodes[idx].value += REWARD(w, mover);
+                        }
+                        mover = NEXT_PLAYER(mover);
+                }
+
+                // proof backup. stops at the first node not proven.
+                int32_t leaf = path_nodes[depth];
+                if (leaf != -1 && m->nodes[leaf].proven != MCTS_PROVEN_NONE) {
+                        for (int i = depth - 1; i >= 0; i--) {
+                                if (!nodeProve(m, &m->nodes[path_nodes[i]])) {
+                                        break;
+                                }
+                        }
+                }
+                TRACE_END(TRACE_BACKUP);
+        }
+        m->playouts = it;
+
+        TRACE_END(TRACE_SEARCH);
+
+        // a proven win first; otherwise, the most visited root edge not
+        // proven lost, if any.
+        struct mcts_node_t *r = &m->nodes[root];
+        if (r->num_edges == 0) return errNew("no legal move.");
+
+        struct mcts_edge_t *best      = NULL;
+        int                 best_lost = 1;
+        for (int i = 0; i < r->num_edges; i++) {
+                struct mcts_edge_t *e      = &m->edges[r->first_edge + i];
+                int                 proven = CHILD_PROVEN(m, e);
+                if (proven == MCTS_PROVEN_WIN) {
+                        best = e;
+                        break;
+                }
+
+                int lost = proven == MCTS_PROVEN_LOSS;
+                if (best == NULL || lost < best_lost ||
+                    (lost == best_lost && e->visits > best->visits)) {
+                        best      = e;
+                        best_lost = lost;
+                }
+        }
+        *col = best->col;
+
+        // the mover into the child is 'next'.
+        int proven = CHILD_PROVEN(m, best);
+        if (proven != MCTS_PROVEN_NONE) {
+                m->score = proven == MCTS_PROVEN_WIN ? 1.0f : 0.0f;
+        } else if (best->child != -1 && m->nodes[best->child].visits > 0) {
+                struct mcts_node_t *c = &m->nodes[best->child];
+                m->score              = c->value / c->visits;
+        } else {
+                m->score = 0.5f;
+        }
+        return OK;
+}
+
+int
+mctsPV(struct mcts_t *m, uint8_t *pv, int max_len)
+{
+        if (m->num_nodes == 0) return 0;
+
+        struct mcts_node_t *n   = &m->nodes[0];
+        int                 len = 0;
+        while (len < max_len && n->num_edges > 0) {
+                struct mcts_edge_t *best = NULL;
+                for (int i = 0; i < n->num_edges; i++) {
+                        struct mcts_edge_t *e = &m->edges[n->first_edge + i];
+                        if (best == NULL || e->visits > best->visits) best = e;
+                }
+                if (best->visits == 0) break;
+
+                pv[len++] = best->col;
+                if (best->child == -1) break;
+                n = &m->nodes[best->child];
+        }
+        return len;
+}
+
+uint32_t
+mctsRootVisits(struct mcts_t *m, uint32_t *visits)
+{
+        if (m->scratch == NULL) return 0;
+        memset(visits, 0, m->scratch->cols * sizeof(*visits));
+        if (m->num_nodes == 0) return 0;
+
+        struct mcts_node_t *r   = &m->nodes[0];
+        uint32_t            sum = 0;
+        for (int i = 0; i < r->num_edges; i++) {
+                struct mcts_edge_t *e = &m->edges[r->first_edge + i];
+                visits[e->col]        = e->visits;
+                sum += e->visits;
+        }
+        return sum;
+}
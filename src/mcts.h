@@ -0,0 +1,123 @@
+#ifndef BB_MCTS_H_
+#define BB_MCTS_H_
+
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+
+// bb
+#include "board.h"
+#include "tt.h"
+
+// -----------------------------------------------------------------------------
+// Monte Carlo Tree Search over a DAG.
+// -----------------------------------------------------------------------------
+//
+// Positions reached through different move orders share one node, found via
+// boardHash. Statistics are split in two, following UCT2 of Childs et al.:
+//
+//   - each edge (s, a) counts the visits through that edge, which drives the
+//     exploration term;
+//   - each node accumulates the results of all visits from any parent, which
+//     is the value term of every edge leading to it.
+//
+// So a transposition shares everything learned about a position while the
+// exploration of each parent stays consistent with its own edge counts.
+//
+// The search is also an MCTS-Solver (Winands et al.): finished games are
+// proven wins for the player moving into them and proofs are backed up with
+// minimax rules. Proven nodes are not searched any further, and proofs are
+// exchanged with other searches through the shared transposition table. As
+// in the alpha-beta search, a proof ending the game in n plies is stored as
+// TT_SCORE_WIN - n for the winner, and n follows the minimax rules too: the
+// winner picks the shortest win, the loser the longest loss.
+
+// With RAVE enabled, each edge also keeps all-moves-as-first (AMAF) counters:
+// the results of playouts through the node where its column was played later
+// by the same player. They are blended into the value term with weight
+// beta = sqrt(k / (3n + k)), n being the edge visits, so they dominate only
+// while the edge is barely visited.
+
+// Proven results, for the player moving into the node.
+#define MCTS_PROVEN_NONE 0
+#define MCTS_PROVEN_WIN  1
+#define MCTS_PROVEN_LOSS 2
+
+struct mcts_opts_t {
+        int   playouts;  // per search.
+        int   nodes;     // node arena capacity.
+        float c_uct;     // exploration constant.
+        int   rave;      // 1 to enable RAVE.
+        float rave_k;    // RAVE equivalence parameter.
+};
+
+struct mcts_node_t {
+        uint64_t hash;
+        int32_t  first_edge;  // index into edges. -1 if not expanded.
+        int16_t  num_edges;
+        int16_t  winner;  // enum player_t if the game is over; else NA.
+        int16_t  proven;  // MCTS_PROVEN_*
+        int16_t  plies;   // to the end of the game, once proven.
+        uint32_t visits;  // over all parents.
+        float    value;   // sum of results for the player moving into it.
+};
+
+// 16 bytes, so the UCT and AMAF counters of an edge share a cache line.
+struct mcts_edge_t {
+        int32_t  child;        // node index. -1 if not created yet.
+        uint32_t visits;       // through this edge only.
+        float    amaf_value;   // sum of AMAF results for the mover.
+        uint16_t amaf_visits;  // halved with amaf_value before overflow.
+        uint8_t  col;
+};
+
+struct mcts_t {
+        struct mcts_opts_t opts;
+
+        struct rng64_t *rng;      // owned.
+        struct tt_t    *tt;       // unowned. NULL-able.
+        struct board_t *scratch;  // owned. NULL before first search.
+        uint8_t        *moves;    // owned. columns of the current playout.
+
+        // arenas, reset per search.
+        struct mcts_node_t *nodes;  // owned.
+        struct mcts_edge_t *edges;  // owned.
+        int                 num_nodes;
+        int                 num_edges;
+        int                 cap_edges;
+
+        // hash -> node index. open addressing with linear probing.
+        int32_t *index;  // owned.
+        size_t   index_mask;
+
+        // of the last search.
+        int   playouts;   // done; fewer once proven.
+        int   max_depth;  // deepest tree ply reached.
+        float score;      // expected result of the chosen move for the mover.
+
+        struct tt_stats_t tt_stats;  // table probes and stores.
+};
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+extern struct mcts_t *mctsNew(const struct mcts_opts_t *opts, uint64_t seed,
+                              struct tt_t *tt);
+extern void           mctsFree(struct mcts_t *m);
+
+// Searches the position 'b', with 'next' to play, and returns the column of
+// the most visited move in 'col'. The nodes stay valid until the next search.
+extern error_t mctsSearch(struct mcts_t *m, struct board_t *b,
+                          enum player_t next, _out_ int *col);
+
+// Fills 'pv' with the columns along the most visited edges from the root of
+// the last search, up to 'max_len'. Returns their count.
+extern int mctsPV(struct mcts_t *m, _out_ uint8_t *pv, int max_len);
+
+// Fills 'visits', of b->cols entries, with the visits of the root edges of the
+// last search per column; 0 for full columns. Returns their sum.
+extern uint32_t mctsRootVisits(struct mcts_t *m, _out_ uint32_t *visits);
+
+#endif  // BB_MCTS_H_
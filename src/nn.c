@@ -0,0 +1,276 @@
+#include "nn.h"
+
+#include <math.h>    // expf, tanhf
+#include <stdlib.h>  // free
+#include <string.h>  // memcpy
+
+// eva
+#include <rng/srng64.h>
+
+// deprecated/src
+#include "bb.h"
+
+// bb
+#include "encode.h"
+#include "weights.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define DEFAULT_BATCH  16
+#define DEFAULT_HIDDEN 128
+
+// builds the layers of the module: two hidden relu layers and the output.
+static error_t
+nnLayers(struct nn_t *nn, int input_dim)
+{
+        const struct nn_opts_t *opts = &nn->opts;
+        return bbCreateLayers(
+            nn->vm,
+            (struct bb_layer_config_t[]){
+                {.tag    = BB_TAG_DENSE,
+                 .config = &(struct bb_dense_config_t){
+                     .input_dim   = input_dim,
+                     .output_dim  = opts->hidden,
+                     .kernel_init = BB_INIT_STD_NORMAL,
+                     .bias_init   = BB_INIT_ZERO,
+                     .actn        = BB_ACTN_RELU}},
+                {.tag    = BB_TAG_DENSE,
+                 .config = &(struct bb_dense_config_t){
+                     .input_dim   = opts->hidden,
+                     .output_dim  = opts->hidden,
+                     .kernel_init = BB_INIT_STD_NORMAL,
+                     .bias_init   = BB_INIT_ZERO,
+                     .actn        = BB_ACTN_RELU}},
+                {.tag    = BB_TAG_DENSE,
+                 .config = &(struct bb_dense_config_t){
+                     .input_dim   = opts->hidden,
+                     .output_dim  = opts->cols + 1,
+                     .kernel_init = BB_INIT_STD_NORMAL,
+                     .bias_init   = BB_INIT_ZERO,
+                     .actn        = BB_ACTN_NONE}},
+                {.tag = BB_TAG_NULL}},
+            &nn->m->layers);
+}
+
+// turns the outputs of one board into the policy over the legal columns and
+// the value.
+static void
+nnDecode(struct board_t *b, const f32_t *out, _out_ float *policy,
+         _out_ float *value)
+{
+        const int cols = b->cols;
+
+        float max = -INFINITY;
+        for (int c = 0; c < cols; c++) {
+                if (boardRowForCol(b, c) == -1) continue;
+                if (out[c] > max) max = out[c];
+        }
+
+        float sum = 0;
+        for (int c = 0; c < cols; c++) {
+                policy[c] = boardRowForCol(b, c) == -1 ? 0 : expf(out[c] - max);
+                sum += policy[c];
+        }
+        for (int c = 0; sum > 0 && c < cols; c++) policy[c] /= sum;
+
+        *value = (tanhf(out[cols]) + 1) / 2;
+}
+
+// copies the tensors of 'w' into the weights of the network. all are checked
+// first, so a mismatching version leaves the weights as they are.
+static error_t
+nnLoad(struct nn_t *nn, const struct weights_t *w)
+{
+        const int num = vecSize(nn->p->weights);
+        if (w->num != num) {
+                return errNew("expect %d weight tensors; got %d.", num,
+                              w->num);
+        }
+
+        f32_t  *data[num];
+        error_t err;
+        for (int i = 0; i < num; i++) {
+                const int       td = nn->p->weights[i];
+                struct shape_t *sp;
+
+                err = vmTensorInfo(nn->vm, td, /*dtype=*/NULL, &sp);
+                if (err) return errEmitNote("failed to grab the weight shape.");
+                if ((size_t)sp->size != w->sizes[i]) {
+                        return errNew("expect %d values for weight %d; "
+                                      "got %zu.",
+                                      sp->size, i, w->sizes[i]);
+                }
+
+                err = vmTensorData(nn->vm, td, (void **)&data[i]);
+                if (err) return errEmitNote("failed to get the weight data.");
+        }
+
+        for (int i = 0; i < num; i++) {
+                memcpy(data[i], w->data[i], w->sizes[i] * sizeof(float));
+        }
+        return OK;
+}
+
+// loads the current version of the weights handle, if newer.
+static error_t
+nnSync(struct nn_t *nn)
+{
+        if (nn->weights == NULL ||
+            weightsVersion(nn->weights) == nn->version) {
+                return OK;
+        }
+
+        struct weights_t *w   = weightsReadBegin(nn->weights, nn->reader);
+        error_t           err = OK;
+        if (w != NULL) {
+                err = nnLoad(nn, w);
+                if (!err) nn->version = w->version;
+        }
+        weightsReadEnd(nn->weights, nn->reader);
+        return err;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+error_t
+nnNew(const struct nn_opts_t *opts, struct nn_t **out)
+{
+        struct nn_t *nn = calloc(1, sizeof(*nn));
+        nn->opts        = *opts;
+        if (nn->opts.batch <= 0) nn->opts.batch = DEFAULT_BATCH;
+        if (nn->opts.hidden <= 0) nn->opts.hidden = DEFAULT_HIDDEN;
+
+        const int input_dim = ENCODE_PLANES * opts->rows * opts->cols;
+        error_t   err;
+
+        nn->vm = bbVmInit();
+        nn->p  = bbProgNew();
+        nn->m  = bbSeqModuleNew();
+        if (nn->vm == NULL || nn->p == NULL || nn->m == NULL) {
+                err = errNew("failed to allocate the network.");
+                goto fail;
+        }
+
+        nn->m->r = srng64New(opts->seed);
+        nn->m->x = vmTensorNew(nn->vm, F32,
+                               R2S(nn->vm, nn->opts.batch, input_dim));
+
+        err = nnLayers(nn, input_dim);
+        if (err) {
+                errEmitNote("failed to create the layers.");
+                goto fail;
+        }
+
+        struct bb_context_t ctx = {.is_training = 0};
+        err = bbCompileSeqModule(&ctx, nn->p, nn->m);
+        if (err) {
+                errEmitNote("failed to compile the network.");
+                goto fail;
+        }
+        nn->out = nn->p->outputs[0];
+
+        err = bbProgCompileToBatchOps(nn->p, &nn->num_ops, &nn->ops);
+        if (err) {
+                errEmitNote("failed to compile the batch ops.");
+                goto fail;
+        }
+
+        *out = nn;
+        return OK;
+
+fail:
+        nnFree(nn);
+        return err;
+}
+
+void
+nnFree(struct nn_t *nn)
+{
+        if (nn == NULL) return;
+        if (nn->weights != NULL) weightsReaderFree(nn->weights, nn->reader);
+        free(nn->ops);
+        bbSeqModuleFree(nn->m);
+        bbProgFree(nn->p);
+        if (nn->vm != NULL) vmFree(nn->vm);
+        free(nn);
+}
+
+error_t
+nnEval(void *ctx, struct board_t *const *boards, int n, float *policy,
+       float *value)
+{
+        struct nn_t *nn   = ctx;
+        const int    cols = nn->opts.cols;
+        error_t      err;
+
+        // a batch running on the old weights is never cut short.
+        err = nnSync(nn);
+        if (err) return errEmitNote("failed to load the weights.");
+
+        for (int i = 0; i < n; i += nn->opts.batch) {
+                const int k = n - i < nn->opts.batch ? n - i : nn->opts.batch;
+
+                err = encodeBatch(nn->vm, nn->m->x, boards + i, k,
+                                  /*mirror=*/NULL);
+                if (err) return errEmitNote("failed to encode the boards.");
+
+                err = vmBatch(nn->vm, nn->num_ops, nn->ops);
+                if (err) return errEmitNote("failed to run the network.");
+
+                f32_t *out;
+                err = vmTensorData(nn->vm, nn->out, (void **)&out);
+                if (err) return errEmitNote("failed to get the outputs.");
+
+                for (int j = 0; j < k; j++) {
+                        nnDecode(boards[i + j], out + j * (cols + 1),
+                                 policy + (i + j) * cols, value + i + j);
+                }
+                nn->batches++;
+                nn->evals += k;
+        }
+        return OK;
+}
+
+error_t
+nnAttach(struct nn_t *nn, struct weights_handle_t *weights)
+{
+        const int reader = weightsReaderNew(weights);
+        if (reader < 0) return errNew("no reader slot left in the weights.");
+
+        if (nn->weights != NULL) weightsReaderFree(nn->weights, nn->reader);
+        nn->weights = weights;
+        nn->reader  = reader;
+        nn->version = 0;
+        return OK;
+}
+
+error_t
+nnPublish(struct weights_handle_t *weights, struct vm_t *vm, const int *tds,
+          int num, uint64_t *version)
+{
+        const float *data[num];
+        size_t       sizes[num];
+        error_t      err;
+
+        for (int i = 0; i < num; i++) {
+                struct shape_t *sp;
+                err = vmTensorInfo(vm, tds[i], /*dtype=*/NULL, &sp);
+                if (err) return errEmitNote("failed to grab the weight shape.");
+                err = vmTensorData(vm, tds[i], (void **)&data[i]);
+                if (err) return errEmitNote("failed to get the weight data.");
+                sizes[i] = sp->size;
+        }
+        return weightsPublish(weights, num, data, sizes, version);
+}
+
+error_t
+nnPublishWeights(struct weights_handle_t *weights, struct nn_t *nn,
+                 uint64_t *version)
+{
+        return nnPublish(weights, nn->vm, nn->p->weights,
+                         vecSize(nn->p->weights), version);
+}
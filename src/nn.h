@@ -0,0 +1,86 @@
+#ifndef BB_NN_H_
+#define BB_NN_H_
+
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+
+// bb
+#include "board.h"
+
+// -----------------------------------------------------------------------------
+// Policy/value network for the PUCT search.
+// -----------------------------------------------------------------------------
+//
+// A stack of dense layers of deprecated/src, compiled in inference mode with
+// bbCompileSeqModule and run with one vmBatch per batch of boards. The input
+// is the encoding of src/encode.h; the output has cols + 1 values per board:
+//
+//   logits of the columns | value logit
+//
+// The policy is the softmax of the logits over the legal columns and the
+// value is (tanh(v) + 1) / 2, the expected result for the side to move.
+//
+// A network attached to a weights handle (see src/weights.h) loads the latest
+// published version at the start of each nnEval, so a running bot switches to
+// a new checkpoint between two batches.
+//
+// Only built with NN=1, which also compiles deprecated/src.
+
+struct vm_t;
+struct oparg_t;
+struct bb_program_t;
+struct bb_seq_module_t;
+struct weights_handle_t;
+
+struct nn_opts_t {
+        int      rows;
+        int      cols;
+        int      batch;   // boards per vmBatch.
+        int      hidden;  // units of the two hidden layers.
+        uint64_t seed;    // for the initial weights.
+};
+
+struct nn_t {
+        struct nn_opts_t opts;
+
+        struct vm_t            *vm;  // owned.
+        struct bb_seq_module_t *m;   // owned.
+        struct bb_program_t    *p;   // owned.
+        struct oparg_t         *ops;  // owned. compiled program.
+        int                     num_ops;
+        int                     out;  // output tensor. [batch, cols + 1]
+
+        struct weights_handle_t *weights;  // unowned. NULL-able.
+        int                      reader;   // slot in 'weights'.
+        uint64_t                 version;  // loaded. 0 => initial weights.
+
+        // of all evaluations.
+        uint64_t batches;
+        uint64_t evals;
+};
+
+extern error_t nnNew(const struct nn_opts_t *opts, _out_ struct nn_t **nn);
+extern void    nnFree(struct nn_t *nn);
+
+// Attaches 'nn' to 'weights', whose versions must match the weight tensors of
+// the network in order and size. Fails if the handle has no reader slot left.
+extern error_t nnAttach(struct nn_t *nn, struct weights_handle_t *weights);
+
+// Publishes the 'num' f32 tensors 'tds' of 'vm', e.g., the weights of the
+// trainer's bb_program_t, as the next version of 'weights'.
+extern error_t nnPublish(struct weights_handle_t *weights, struct vm_t *vm,
+                         const int *tds, int num, _out_ uint64_t *version);
+
+// Publishes the current weights of 'nn', e.g., of a network built from another
+// seed, as the next version of 'weights'.
+extern error_t nnPublishWeights(struct weights_handle_t *weights,
+                                struct nn_t *nn, _out_ uint64_t *version);
+
+// A puct_eval_fn with 'ctx' as the nn_t. Boards beyond opts.batch take more
+// vmBatch calls.
+extern error_t nnEval(void *ctx, struct board_t *const *boards, int n,
+                      _out_ float *policy, _out_ float *value);
+
+#endif  // BB_NN_H_
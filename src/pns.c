@@ -0,0 +1,356 @@
+#include "pns.h"
+
+#include <assert.h>
+#include <stdlib.h>  // malloc
+#include <string.h>  // memset
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+// keys of the two runs differ, so they share one table.
+#define SALT_BLACK 0x9e3779b97f4a7c15ULL
+#define SALT_WHITE 0xc2b2ae3d27d4eb4fULL
+
+// the child delta threshold is (1 + 1/EPSILON_INV) times the second best one.
+#define EPSILON_INV 4
+
+// garbage collection starts at 3/4 load and drops half of the entries.
+#define GC_LOAD_NUM 3
+#define GC_LOAD_DEN 4
+
+static uint64_t
+keyOf(enum player_t attacker, uint64_t hash)
+{
+        uint64_t key = hash ^ (attacker == PLAYER_BLACK ? SALT_BLACK
+                                                        : SALT_WHITE);
+        return key == 0 ? 1 : key;  // 0 marks empty slots.
+}
+
+static uint32_t
+addSat(uint32_t a, uint32_t b)
+{
+        if (a == PNS_INF || b == PNS_INF) return PNS_INF;
+        uint64_t sum = (uint64_t)a + b;
+        return sum >= PNS_INF ? PNS_INF - 1 : (uint32_t)sum;
+}
+
+static uint32_t
+clampInf(uint64_t v)
+{
+        return v >= PNS_INF ? PNS_INF : (uint32_t)v;
+}
+
+// returns the slot holding 'key', or the empty slot where it belongs.
+static struct pns_entry_t *
+slotFor(struct pns_t *p, uint64_t key)
+{
+        size_t i = key & p->mask;
+        while (p->table[i].key != 0 && p->table[i].key != key) {
+                i = (i + 1) & p->mask;
+        }
+        return &p->table[i];
+}
+
+// refreshes a child from the table. a child missing from the table keeps the
+// numbers of its frame, so the garbage collection never loses the progress
+// made along the current path.
+static void
+tableLookup(struct pns_t *p, struct pns_child_t *c)
+{
+        struct pns_entry_t *e = slotFor(p, c->key);
+        if (e->key == 0) return;
+
+        c->phi   = e->phi;
+        c->delta = e->delta;
+        c->work  = e->work;
+}
+
+// bucket of 'work' in the gc histogram.
+static int
+workLog2(uint64_t work)
+{
+        return 64 - __builtin_clzll(work + 1);  // 1..64; 0 for UINT64_MAX.
+}
+
+// drops at least half of the entries, those with the least work, and then
+// re-inserts the survivors so the probe sequences have no holes.
+static void
+tableGC(struct pns_t *p)
+{
+        const size_t slots = p->mask + 1;
+
+        size_t hist[65] = {0};
+        for (size_t i = 0; i < slots; i++) {
+                if (p->table[i].key != 0) hist[workLog2(p->table[i].work)]++;
+        }
+
+        // the smallest bucket bound dropping half of the entries.
+        int    bound   = 0;
+        size_t dropped = 0;
+        while (bound < 65 && dropped < p->count / 2) dropped += hist[bound++];
+
+        for (size_t i = 0; i < slots; i++) {
+                struct pns_entry_t *e = &p->table[i];
+                if (e->key != 0 && workLog2(e->work) < bound) e->key = 0;
+        }
+
+        // start right after an empty slot, so no cluster wraps around it.
+        size_t start = 0;
+        while (p->table[start].key != 0) start++;
+        for (size_t n = 1; n <= slots; n++) {
+                struct pns_entry_t *e = &p->table[(start + n) & p->mask];
+                if (e->key == 0) continue;
+
+                struct pns_entry_t tmp = *e;
+                e->key                 = 0;
+                *slotFor(p, tmp.key)   = tmp;
+        }
+
+        p->count -= dropped;
+        p->gc_runs++;
+        p->gc_freed += dropped;
+}
+
+static void
+tableStore(struct pns_t *p, uint64_t key, uint32_t phi, uint32_t delta,
+           uint64_t work)
+{
+        if (p->count >= (p->mask + 1) / GC_LOAD_DEN * GC_LOAD_NUM) {
+                tableGC(p);
+        }
+
+        struct pns_entry_t *e = slotFor(p, key);
+        if (e->key == 0) {
+                e->key = key;
+                p->count++;
+        }
+        e->phi   = phi;
+        e->delta = delta;
+        e->work  = work;
+}
+
+// -----------------------------------------------------------------------------
+// df-pn.
+// -----------------------------------------------------------------------------
+//
+// Negamax form: 'phi' is the proof number for the side to move achieving its
+// goal (winning for the attacker; not losing for the defender) and 'delta'
+// the disproof number. So
+//
+//   phi(n)   = min over children of delta(c),
+//   delta(n) = sum over children of phi(c).
+
+// generates the children of the position at 'depth'. returns their count.
+static int
+expand(struct pns_t *p, struct board_t *b, enum player_t to_move, int depth)
+{
+        struct pns_child_t *cs = &p->children[depth * b->cols];
+        int                 n  = 0;
+
+        for (int col = 0; col < b->cols; col++) {
+                int row = boardRowForCol(b, col);
+                if (row == -1) continue;
+
+                // unknown positions start at (1, 1).
+                struct pns_child_t *c = &cs[n++];
+                c->col                = col;
+                c->phi                = 1;
+                c->delta              = 1;
+                c->work               = 0;
+
+                boardSet(b, row, col, to_move, 0);
+                enum player_t w = boardWinnerAt(b, row, col);
+                if (w == PLAYER_NA) {
+                        c->key      = keyOf(p->attacker, boardHash(b));
+                        c->terminal = 0;
+                } else {
+                        // a win for to_move fails the goal of the child's
+                        // side to move; a tie only fails the attacker's.
+                        int achieved = w == PLAYER_TIE &&
+                                       NEXT_PLAYER(to_move) != p->attacker;
+                        c->key      = 0;
+                        c->terminal = 1;
+                        c->phi      = achieved ? 0 : PNS_INF;
+                        c->delta    = achieved ? PNS_INF : 0;
+                }
+                boardSet(b, row, col, PLAYER_NA, 0);
+        }
+        return n;
+}
+
+// searches the position 'key' at 'depth' until its proof or disproof number
+// reaches its threshold, then stores it. the scratch board holds the
+// position and is restored on return.
+static void
+mid(struct pns_t *p, uint64_t key, enum player_t to_move, int depth,
+    uint32_t th_phi, uint32_t th_delta, _out_ uint32_t *phi,
+    _out_ uint32_t *delta)
+{
+        struct board_t     *b          = p->scratch;
+        struct pns_child_t *cs         = &p->children[depth * b->cols];
+        const uint64_t      nodes_base = p->nodes++;
+
+        const int n = expand(p, b, to_move, depth);
+        assert(n > 0);  // a full board is a tie, found by the parent.
+
+        uint32_t phi_n, delta_n;
+        int      best;
+        while (1) {
+                uint32_t delta_2 = PNS_INF;  // second smallest child delta.
+
+                best    = 0;
+                phi_n   = PNS_INF;
+                delta_n = 0;
+                for (int i = 0; i < n; i++) {
+                        struct pns_child_t *c = &cs[i];
+                        if (!c->terminal) tableLookup(p, c);
+
+                        delta_n = addSat(delta_n, c->phi);
+                        if (c->delta < phi_n) {
+                                delta_2 = phi_n;
+                                phi_n   = c->delta;
+                                best    = i;
+                        } else if (c->delta < delta_2) {
+                                delta_2 = c->delta;
+                        }
+                }
+
+                if (phi_n >= th_phi || delta_n >= th_delta) break;
+                if (p->max_nodes != 0 && p->nodes >= p->max_nodes) {
+                        p->aborted = 1;
+                        break;
+                }
+
+                struct pns_child_t *c = &cs[best];
+
+                uint32_t th_phi_c = clampInf((uint64_t)th_delta - delta_n +
+                                             c->phi);
+                uint64_t grown = (uint64_t)delta_2 + delta_2 / EPSILON_INV;
+                uint64_t th_delta_c =
+                    grown > (uint64_t)delta_2 + 1 ? grown : delta_2 + 1;
+                if (th_delta_c > th_phi) th_delta_c = th_phi;
+
+                int row = boardRowForCol(b, c->col);
+                boardSet(b, row, c->col, to_move, 0);
+                mid(p, c->key, NEXT_PLAYER(to_move), depth + 1, th_phi_c,
+                    (uint32_t)th_delta_c, &c->phi, &c->delta);
+                boardSet(b, row, c->col, PLAYER_NA, 0);
+
+                if (p->aborted) break;
+        }
+
+        if (depth == 0) {
+                // a proof goes through a child with zero delta, i.e., 'best';
+                // otherwise, the hardest child to refute.
+                if (phi_n != 0) {
+                        for (int i = 0; i < n; i++) {
+                                if (cs[i].work > cs[best].work) best = i;
+                        }
+                }
+                p->best_col = cs[best].col;
+        }
+
+        tableStore(p, key, phi_n, delta_n, p->nodes - nodes_base);
+        *phi   = phi_n;
+        *delta = delta_n;
+}
+
+// searches whether 'attacker' wins from the root. returns 1 if the side to
+// move at the root reaches its goal, 0 if not and -1 if aborted. the goal is a
+// win if it is the attacker, and not losing otherwise, so with the defender
+// to move, 1 means the attacker cannot win.
+static int
+run(struct pns_t *p, struct board_t *b, enum player_t next,
+    enum player_t attacker)
+{
+        p->attacker = attacker;
+
+        uint32_t phi, delta;
+        mid(p, keyOf(attacker, boardHash(b)), next, 0, PNS_INF, PNS_INF, &phi,
+            &delta);
+        if (p->aborted) return -1;
+
+        assert(phi == 0 || delta == 0);
+        return phi == 0;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+struct pns_t *
+pnsNew(size_t bytes)
+{
+        size_t slots = 16;
+        while (slots * 2 * sizeof(struct pns_entry_t) <= bytes) slots *= 2;
+
+        struct pns_t *p = calloc(1, sizeof(*p));
+        p->table        = calloc(slots, sizeof(*p->table));
+        p->mask         = slots - 1;
+        if (p->table == NULL) {
+                free(p);
+                return NULL;
+        }
+        return p;
+}
+
+void
+pnsFree(struct pns_t *p)
+{
+        if (p == NULL) return;
+        boardFree(p->scratch);
+        free(p->children);
+        free(p->table);
+        free(p);
+}
+
+void
+pnsClear(struct pns_t *p)
+{
+        memset(p->table, 0, (p->mask + 1) * sizeof(*p->table));
+        p->count = 0;
+}
+
+error_t
+pnsSolve(struct pns_t *p, struct board_t *b, enum player_t next,
+         uint64_t max_nodes, int *result, int *col)
+{
+        if (boardWinner(b) != PLAYER_NA) return errNew("game is over.");
+
+        if (p->scratch == NULL || p->scratch->rows != b->rows ||
+            p->scratch->cols != b->cols) {
+                boardFree(p->scratch);
+                free(p->children);
+                p->scratch  = boardClone(b);
+                p->children = malloc((size_t)b->rows * b->cols * b->cols *
+                                     sizeof(*p->children));
+        }
+        boardCopy(p->scratch, b);
+
+        p->max_nodes = max_nodes;
+        p->aborted   = 0;
+        p->nodes     = 0;
+        p->gc_runs   = 0;
+        p->gc_freed  = 0;
+
+        *result = PNS_UNKNOWN;
+        *col    = -1;
+
+        // a win for 'next' first; if disproven, a win for the opponent.
+        int proven = run(p, p->scratch, next, next);
+        if (proven == -1) return OK;
+        if (proven) {
+                *result = PNS_WIN;
+                *col    = p->best_col;
+                return OK;
+        }
+
+        proven = run(p, p->scratch, next, NEXT_PLAYER(next));
+        if (proven == -1) return OK;
+
+        // the root is the defender now, so a proof for it is a draw.
+        *result = proven ? PNS_DRAW : PNS_LOSS;
+        *col    = p->best_col;
+        return OK;
+}
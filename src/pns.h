@@ -0,0 +1,103 @@
+#ifndef BB_PNS_H_
+#define BB_PNS_H_
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+
+// bb
+#include "board.h"
+
+// -----------------------------------------------------------------------------
+// Proof-number search.
+// -----------------------------------------------------------------------------
+//
+// An exact solver based on depth-first proof-number search (df-pn, Nagai)
+// with the 1 + epsilon threshold trick (Pawlewicz and Lew). Unlike the
+// best-first PN search, df-pn keeps no tree: the proof and disproof numbers
+// of all visited positions live in a hash table of fixed size, so the search
+// runs in bounded memory and only slows down once the table is full.
+//
+// When the table is 3/4 full, a garbage collection drops the half of the
+// entries with the least work below them, i.e., the cheapest ones to search
+// again.
+//
+// Each run answers "can the attacker win?", where a tie counts as a failure.
+// pnsSolve runs it for the side to move and, if disproven, for the opponent,
+// to tell wins, draws and losses apart. Both runs share the table.
+
+// Results, for the side to move.
+#define PNS_UNKNOWN 0  // node budget exhausted.
+#define PNS_WIN     1
+#define PNS_DRAW    2
+#define PNS_LOSS    3
+
+// Proof and disproof numbers saturate below PNS_INF, which marks a solved
+// position.
+#define PNS_INF UINT32_MAX
+
+struct pns_entry_t {
+        uint64_t key;    // position hash, salted per attacker. 0 if empty.
+        uint32_t phi;    // proof number for the side to move.
+        uint32_t delta;  // disproof number for the side to move.
+        uint64_t work;   // nodes searched below this entry.
+};
+
+// one child in a search frame.
+struct pns_child_t {
+        uint64_t key;
+        uint32_t phi;
+        uint32_t delta;
+        uint64_t work;
+        int      col;
+        int      terminal;  // 1 if phi and delta are final.
+};
+
+struct pns_t {
+        // hash table. open addressing with linear probing.
+        struct pns_entry_t *table;  // owned.
+        size_t              mask;   // slots - 1.
+        size_t              count;  // used slots.
+
+        // per search.
+        struct board_t     *scratch;    // owned. NULL before first search.
+        struct pns_child_t *children;   // owned. cols entries per depth.
+        enum player_t       attacker;   // of the current run.
+        uint64_t            max_nodes;  // 0 => unlimited.
+        int                 aborted;    // 1 if the budget ran out.
+        int                 best_col;   // root move of the last run.
+
+        // stats. reset per pnsSolve.
+        uint64_t nodes;      // nodes searched.
+        uint64_t gc_runs;    // garbage collections.
+        uint64_t gc_freed;   // entries dropped by them.
+};
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+// Allocates a solver whose table uses at most 'bytes' (rounded down to a power
+// of 2 slots, and at least 16). Returns NULL if allocation fails.
+extern struct pns_t *pnsNew(size_t bytes);
+extern void          pnsFree(struct pns_t *p);
+
+// Drops all entries.
+extern void pnsClear(struct pns_t *p);
+
+// Solves the position 'b' with 'next' to play, searching at most 'max_nodes'
+// nodes (0 => unlimited). 'result' is one of PNS_*, for 'next'.
+//
+// 'col' is a move achieving the result: a winning move for PNS_WIN, a drawing
+// move for PNS_DRAW and the move with the largest proof for PNS_LOSS. It is
+// -1 for PNS_UNKNOWN.
+//
+// The table is kept across calls, so solving the positions along a game
+// reuses earlier work.
+extern error_t pnsSolve(struct pns_t *p, struct board_t *b, enum player_t next,
+                        uint64_t max_nodes, _out_ int *result,
+                        _out_ int *col);
+
+#endif  // BB_PNS_H_
@@ -0,0 +1,352 @@
+#include "puct.h"
+
+#include <math.h>    // sqrtf
+#include <stdlib.h>  // malloc
+#include <string.h>  // memset
+
+// bb
+#include "trace.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define DEFAULT_PLAYOUTS 800
+#define DEFAULT_NODES    100000
+#define DEFAULT_BATCH    16
+#define DEFAULT_C_PUCT   1.5f
+
+// returns the new node index, or -1 if the arena is full.
+static int32_t
+nodeNew(struct puct_t *p, int32_t parent, int col, float prior,
+        enum player_t winner)
+{
+        if (p->num_nodes == p->opts.nodes) return -1;
+
+        int32_t             idx = p->num_nodes++;
+        struct puct_node_t *n   = &p->nodes[idx];
+        n->parent               = parent;
+        n->first_child          = -1;
+        n->num_children         = 0;
+        n->col                  = col;
+        n->pending              = 0;
+        n->winner               = winner;
+        n->prior                = prior;
+        n->visits               = 0;
+        n->inflight             = 0;
+        n->value                = 0;
+        return idx;
+}
+
+// creates one child per legal column of the leaf 'idx' on 'b', with 'to_move'
+// to play, and the priors of 'policy' renormalized over them. the winners of
+// the children are found here, so finished games are never evaluated.
+// returns -1 if the arena is full.
+static int
+nodeExpand(struct puct_t *p, int32_t idx, struct board_t *b,
+           enum player_t to_move, const float *policy)
+{
+        const int cols = b->cols;
+        if (p->num_nodes + cols > p->opts.nodes) return -1;
+
+        float sum   = 0;
+        int   legal = 0;
+        for (int col = 0; col < cols; col++) {
+                if (boardRowForCol(b, col) == -1) continue;
+                sum += policy[col];
+                legal++;
+        }
+
+        const int32_t first = p->num_nodes;
+        for (int col = 0; col < cols; col++) {
+                int row = boardRowForCol(b, col);
+                if (row == -1) continue;
+
+                boardSet(b, row, col, to_move, 0);
+                enum player_t w = boardWinnerAt(b, row, col);
+                boardSet(b, row, col, PLAYER_NA, 0);
+
+                float prior = sum > 0 ? policy[col] / sum : 1.0f / legal;
+                nodeNew(p, idx, col, prior, w);
+        }
+
+        p->nodes[idx].first_child  = first;
+        p->nodes[idx].num_children = p->num_nodes - first;
+        return 0;
+}
+
+// picks the child with the best PUCT score. children in flight count as
+// losses, and unvisited ones start at the value of the parent for its side
+// to move.
+static int32_t
+childSelect(struct puct_t *p, struct puct_node_t *n)
+{
+        const float sqrt_n = sqrtf((float)(n->visits + n->inflight));
+        const float fpu    = n->visits > 0 ? 1 - n->value / n->visits : 0.5f;
+
+        int32_t best       = -1;
+        float   best_score = -1;
+        for (int i = 0; i < n->num_children; i++) {
+                struct puct_node_t *c = &p->nodes[n->first_child + i];
+
+                const uint32_t visits = c->visits + c->inflight;
+                const float    q      = visits > 0 ? c->value / visits : fpu;
+                const float    score =
+                    q + p->opts.c_puct * c->prior * sqrt_n / (1 + visits);
+                if (score > best_score) {
+                        best       = n->first_child + i;
+                        best_score = score;
+                }
+        }
+        return best;
+}
+
+// descends from the root, playing the moves on 'b', and adds a virtual loss
+// to each node on the way. stops at a node not expanded or a finished game.
+static int32_t
+descend(struct puct_t *p, struct board_t *b, enum player_t next,
+        _out_ enum player_t *to_move)
+{
+        int32_t cur   = 0;
+        int     depth = 0;
+
+        *to_move = next;
+        p->nodes[cur].inflight++;
+        while (p->nodes[cur].first_child != -1 &&
+               p->nodes[cur].winner == PLAYER_NA) {
+                cur                   = childSelect(p, &p->nodes[cur]);
+                struct puct_node_t *n = &p->nodes[cur];
+
+                boardSet(b, boardRowForCol(b, n->col), n->col, *to_move, 0);
+                *to_move = NEXT_PLAYER(*to_move);
+                n->inflight++;
+                depth++;
+        }
+        if (depth > p->max_depth) p->max_depth = depth;
+        return cur;
+}
+
+// backs up 'r', the result for the player moving into 'leaf', and replaces
+// the virtual losses of the descent with it.
+static void
+backup(struct puct_t *p, int32_t leaf, float r)
+{
+        for (int32_t i = leaf; i != -1; i = p->nodes[i].parent) {
+                struct puct_node_t *n = &p->nodes[i];
+                n->inflight--;
+                n->visits++;
+                n->value += r;
+                r = 1 - r;
+        }
+}
+
+// drops the virtual losses of a descent that reached a queued leaf.
+static void
+revert(struct puct_t *p, int32_t leaf)
+{
+        for (int32_t i = leaf; i != -1; i = p->nodes[i].parent) {
+                p->nodes[i].inflight--;
+        }
+}
+
+// resets the arena and makes sure the batch buffers fit the board.
+static error_t
+searchReset(struct puct_t *p, struct board_t *b)
+{
+        if (b->cols > UINT8_MAX) {
+                return errNew("too many columns for puct: %d", b->cols);
+        }
+        if (p->opts.nodes < 1 + b->cols) {
+                return errNew("too few nodes for puct: %d", p->opts.nodes);
+        }
+
+        if (p->leaves == NULL || p->rows != b->rows || p->cols != b->cols) {
+                for (int i = 0; p->leaves != NULL && i < p->opts.batch; i++) {
+                        boardFree(p->leaves[i]);
+                }
+                free(p->leaves);
+                free(p->policy);
+
+                const int batch = p->opts.batch;
+                p->leaves       = malloc(batch * sizeof(*p->leaves));
+                for (int i = 0; i < batch; i++) p->leaves[i] = boardClone(b);
+                p->policy = malloc(batch * b->cols * sizeof(*p->policy));
+                p->rows   = b->rows;
+                p->cols   = b->cols;
+        }
+
+        p->num_nodes = 0;
+        return OK;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+struct puct_t *
+puctNew(const struct puct_opts_t *opts, puct_eval_fn eval, void *ctx)
+{
+        struct puct_t *p = calloc(1, sizeof(*p));
+        p->opts          = *opts;
+        if (p->opts.playouts <= 0) p->opts.playouts = DEFAULT_PLAYOUTS;
+        if (p->opts.nodes <= 0) p->opts.nodes = DEFAULT_NODES;
+        if (p->opts.batch <= 0) p->opts.batch = DEFAULT_BATCH;
+        if (p->opts.c_puct <= 0) p->opts.c_puct = DEFAULT_C_PUCT;
+
+        p->eval    = eval;
+        p->ctx     = ctx;
+        p->queued  = malloc(p->opts.batch * sizeof(*p->queued));
+        p->to_move = malloc(p->opts.batch * sizeof(*p->to_move));
+        p->value   = malloc(p->opts.batch * sizeof(*p->value));
+        p->nodes   = malloc(p->opts.nodes * sizeof(*p->nodes));
+        return p;
+}
+
+void
+puctFree(struct puct_t *p)
+{
+        if (p == NULL) return;
+        for (int i = 0; p->leaves != NULL && i < p->opts.batch; i++) {
+                boardFree(p->leaves[i]);
+        }
+        free(p->leaves);
+        free(p->queued);
+        free(p->to_move);
+        free(p->policy);
+        free(p->value);
+        free(p->nodes);
+        free(p);
+}
+
+error_t
+puctSearch(struct puct_t *p, struct board_t *b, enum player_t next, int *col)
+{
+        if (boardWinner(b) != PLAYER_NA) return errNew("game is over.");
+
+        error_t err = searchReset(p, b);
+        if (err) return err;
+
+        nodeNew(p, /*parent=*/-1, /*col=*/0, /*prior=*/1, PLAYER_NA);
+
+        p->playouts  = 0;
+        p->max_depth = 0;
+        p->batches   = 0;
+        p->evals     = 0;
+
+        TRACE_BEGIN(TRACE_SEARCH);
+
+        // the first batch holds the root alone: any further descent would
+        // reach it again while it is queued.
+        int full = 0;
+        while (p->playouts < p->opts.playouts && !full) {
+                // gathers leaves until the batch is full or a descent
+                // collides with a queued leaf. finished games are backed up
+                // right away.
+                int n = 0;
+                while (n < p->opts.batch &&
+                       p->playouts + n < p->opts.playouts) {
+                        struct board_t *leaf_b = p->leaves[n];
+                        boardCopy(leaf_b, b);
+
+                        enum player_t       to_move;
+                        int32_t             leaf = descend(p, leaf_b, next,
+                                                           &to_move);
+                        struct puct_node_t *l    = &p->nodes[leaf];
+
+                        if (l->winner != PLAYER_NA) {
+                                // won by the mover, unless tied.
+                                backup(p, leaf,
+                                       l->winner == PLAYER_TIE ? 0.5f : 1.0f);
+                                p->playouts++;
+                                continue;
+                        }
+                        if (l->pending) {
+                                revert(p, leaf);
+                                break;
+                        }
+
+                        l->pending    = 1;
+                        p->queued[n]  = leaf;
+                        p->to_move[n] = to_move;
+                        n++;
+                }
+                if (n == 0) continue;
+
+                TRACE_BEGIN(TRACE_EVAL);
+                err = p->eval(p->ctx, p->leaves, n, p->policy, p->value);
+                TRACE_END(TRACE_EVAL);
+                if (err) {
+                        TRACE_END(TRACE_SEARCH);
+                        return errEmitNote("failed to evaluate %d leaves.", n);
+                }
+                p->batches++;
+                p->evals += n;
+
+                // an arena too full to expand a leaf ends the search, but
+                // its value still counts.
+                for (int i = 0; i < n; i++) {
+                        const int32_t leaf = p->queued[i];
+                        p->nodes[leaf].pending = 0;
+                        if (nodeExpand(p, leaf, p->leaves[i], p->to_move[i],
+                                       p->policy + i * b->cols)) {
+                                full = 1;
+                        }
+                        backup(p, leaf, 1 - p->value[i]);
+                        p->playouts++;
+                }
+        }
+
+        TRACE_END(TRACE_SEARCH);
+
+        struct puct_node_t *r = &p->nodes[0];
+        if (r->num_children == 0) return errNew("no legal move.");
+
+        struct puct_node_t *best = NULL;
+        for (int i = 0; i < r->num_children; i++) {
+                struct puct_node_t *c = &p->nodes[r->first_child + i];
+                if (best == NULL || c->visits > best->visits) best = c;
+        }
+        *col = best->col;
+
+        // the mover into the child is 'next'.
+        p->score = best->visits > 0 ? best->value / best->visits : 0.5f;
+        return OK;
+}
+
+int
+puctPV(struct puct_t *p, uint8_t *pv, int max_len)
+{
+        if (p->num_nodes == 0) return 0;
+
+        struct puct_node_t *n   = &p->nodes[0];
+        int                 len = 0;
+        while (len < max_len && n->num_children > 0) {
+                struct puct_node_t *best = NULL;
+                for (int i = 0; i < n->num_children; i++) {
+                        struct puct_node_t *c = &p->nodes[n->first_child + i];
+                        if (best == NULL || c->visits > best->visits) best = c;
+                }
+                if (best->visits == 0) break;
+
+                pv[len++] = best->col;
+                n         = best;
+        }
+        return len;
+}
+
+uint32_t
+puctRootVisits(struct puct_t *p, uint32_t *visits)
+{
+        if (p->leaves == NULL) return 0;
+        memset(visits, 0, p->cols * sizeof(*visits));
+        if (p->num_nodes == 0) return 0;
+
+        struct puct_node_t *r   = &p->nodes[0];
+        uint32_t            sum = 0;
+        for (int i = 0; i < r->num_children; i++) {
+                struct puct_node_t *c = &p->nodes[r->first_child + i];
+                visits[c->col]        = c->visits;
+                sum += c->visits;
+        }
+        return sum;
+}
@@ -0,0 +1,104 @@
+#ifndef BB_PUCT_H_
+#define BB_PUCT_H_
+
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+
+// bb
+#include "board.h"
+
+// -----------------------------------------------------------------------------
+// PUCT search guided by a policy/value evaluator.
+// -----------------------------------------------------------------------------
+//
+// AlphaZero-style search: a leaf is not played out but evaluated, which gives
+// a prior over its moves and a value for the side to move. Children are picked
+// by
+//
+//   q + c_puct * prior * sqrt(N) / (1 + n)
+//
+// where N and n are the visits of the parent and the child.
+//
+// Evaluation is expensive per call and cheap per position, so leaves are
+// gathered into batches. Each descent adds a virtual loss to the nodes on its
+// path, which steers the following descents of the same batch elsewhere; a
+// descent reaching a leaf already queued ends the batch early. Once the batch
+// is evaluated, the leaves are expanded and their values backed up, which
+// replaces the virtual losses with the real results.
+
+// Evaluates 'n' positions of the same geometry. Fills policy[i * cols + c]
+// with the prior of column c for boards[i], 0 for full columns, and value[i]
+// with the expected result in [0, 1] for the side to move.
+typedef error_t (*puct_eval_fn)(void *ctx, struct board_t *const *boards,
+                                int n, _out_ float *policy,
+                                _out_ float *value);
+
+struct puct_opts_t {
+        int   playouts;  // leaf evaluations per search, terminals included.
+        int   nodes;     // node arena capacity.
+        int   batch;     // leaves per evaluation call.
+        float c_puct;    // exploration constant.
+};
+
+struct puct_node_t {
+        int32_t  parent;       // -1 for the root.
+        int32_t  first_child;  // -1 if not expanded.
+        uint8_t  num_children;
+        uint8_t  col;      // the move into the node.
+        uint8_t  pending;  // queued for evaluation.
+        int16_t  winner;   // enum player_t if the game is over; else NA.
+        float    prior;
+        uint32_t visits;
+        uint32_t inflight;  // virtual losses of the descents in flight.
+        float    value;     // sum of results for the player moving into it.
+};
+
+struct puct_t {
+        struct puct_opts_t opts;
+
+        puct_eval_fn eval;
+        void        *ctx;  // unowned. passed to eval.
+
+        struct board_t **leaves;   // owned. [batch] boards of queued leaves.
+        int32_t         *queued;   // owned. [batch] nodes of queued leaves.
+        int8_t          *to_move;  // owned. [batch] enum player_t
+        float           *policy;   // owned. [batch * cols]
+        float           *value;    // owned. [batch]
+        int              rows;
+        int              cols;
+
+        struct puct_node_t *nodes;  // owned. arena, reset per search.
+        int                 num_nodes;
+
+        // of the last search.
+        int      playouts;   // done.
+        int      max_depth;  // deepest tree ply reached.
+        int      batches;    // evaluation calls.
+        uint64_t evals;      // positions evaluated.
+        float    score;      // expected result of the chosen move.
+};
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+extern struct puct_t *puctNew(const struct puct_opts_t *opts,
+                              puct_eval_fn eval, void *ctx);
+extern void           puctFree(struct puct_t *p);
+
+// Searches the position 'b', with 'next' to play, and returns the column of
+// the most visited move in 'col'. The nodes stay valid until the next search.
+extern error_t puctSearch(struct puct_t *p, struct board_t *b,
+                          enum player_t next, _out_ int *col);
+
+// Fills 'pv' with the columns along the most visited children from the root
+// of the last search, up to 'max_len'. Returns their count.
+extern int puctPV(struct puct_t *p, _out_ uint8_t *pv, int max_len);
+
+// Fills 'visits', of b->cols entries, with the visits of the root children of
+// the last search per column; 0 for full columns. Returns their sum.
+extern uint32_t puctRootVisits(struct puct_t *p, _out_ uint32_t *visits);
+
+#endif  // BB_PUCT_H_
@@ -0,0 +1,358 @@
+#include "record.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>  // open
+#include <stdlib.h>
+#include <string.h>  // memcmp, strcmp, strerror
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>  // ftruncate
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define MAGIC       "BBGR"
+#define HEADER_SIZE 8
+#define GAME_SIZE   4  // fixed part of a game.
+#define BOT_SIZE    4  // fixed part of a bot.
+
+#define MOVES_BITS  14
+#define MOVES_MAX   ((1 << MOVES_BITS) - 1)
+
+static int
+winnerCode(int winner)
+{
+        switch (winner) {
+        case PLAYER_BLACK: return RECORD_WINNER_BLACK;
+        case PLAYER_WHITE: return RECORD_WINNER_WHITE;
+        case PLAYER_TIE: return RECORD_WINNER_TIE;
+        default: return RECORD_WINNER_NA;
+        }
+}
+
+static enum player_t
+winnerOf(int code)
+{
+        switch (code) {
+        case RECORD_WINNER_BLACK: return PLAYER_BLACK;
+        case RECORD_WINNER_WHITE: return PLAYER_WHITE;
+        case RECORD_WINNER_TIE: return PLAYER_TIE;
+        default: return PLAYER_NA;
+        }
+}
+
+static error_t
+headerParse(const uint8_t *data, size_t size, struct record_header_t *h)
+{
+        if (size < HEADER_SIZE || memcmp(data, MAGIC, 4) != 0) {
+                return errNew("not a game record file.");
+        }
+        if (data[4] != RECORD_VERSION) {
+                return errNew("unsupported record version: %d", data[4]);
+        }
+        h->rows       = data[5];
+        h->cols       = data[6];
+        h->num_to_win = data[7];
+        return OK;
+}
+
+// walks the entries after the header. fills 'offsets' if not NULL and 'bots'
+// with the names declared, if not NULL. returns the end of the last complete
+// entry; a torn entry after it is ignored.
+static size_t
+indexGames(const uint8_t *data, size_t size, uint64_t *offsets,
+           uint64_t *num_games, sds_t *bots, int *num_bots)
+{
+        size_t   pos = HEADER_SIZE;
+        uint64_t n   = 0;
+        int      k   = 0;
+        while (pos + GAME_SIZE <= size) {
+                const int v = data[pos + 2] | data[pos + 3] << 8;
+
+                if (data[pos] == RECORD_BOT) {
+                        const size_t end = pos + BOT_SIZE + v;
+                        if (end > size) break;
+
+                        const int id = data[pos + 1];
+                        if (bots != NULL && id < RECORD_MAX_BOTS &&
+                            bots[id] == NULL) {
+                                bots[id] = sdsEmpty();
+                                sdsCatPrintf(&bots[id], "%.*s", v,
+                                             (const char *)data + pos +
+                                                 BOT_SIZE);
+                        }
+                        if (id >= k) k = id + 1;
+                        pos = end;
+                        continue;
+                }
+
+                const size_t end = pos + GAME_SIZE + ((v & MOVES_MAX) + 1) / 2;
+                if (end > size) break;
+
+                if (offsets != NULL) offsets[n] = pos;
+                n++;
+                pos = end;
+        }
+        *num_games = n;
+        if (num_bots != NULL) *num_bots = k;
+        return pos;
+}
+
+static void
+botsFree(sds_t *bots)
+{
+        for (int i = 0; i < RECORD_MAX_BOTS; i++) {
+                if (bots[i] != NULL) sdsFree(bots[i]);
+        }
+}
+
+// maps all of 'fd' read-only. 'size' is 0 for an empty file.
+static error_t
+mapFile(int fd, const uint8_t **data, size_t *size)
+{
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+                return errNew("failed to stat: %s", strerror(errno));
+        }
+
+        *size = st.st_size;
+        *data = NULL;
+        if (*size == 0) return OK;
+
+        void *p = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+                return errNew("failed to mmap: %s", strerror(errno));
+        }
+        *data = p;
+        return OK;
+}
+
+// -----------------------------------------------------------------------------
+// writer.
+// -----------------------------------------------------------------------------
+
+error_t
+recordWriterOpen(const char *path, const struct record_header_t *h,
+                 struct record_writer_t **w)
+{
+        if (h->cols > RECORD_MAX_COLS) {
+                return errNew("too many columns for records: %d", h->cols);
+        }
+
+        FILE *f = fopen(path, "a+b");
+        if (f == NULL) {
+                return errNew("failed to open %s: %s", path, strerror(errno));
+        }
+
+        struct record_writer_t *p = calloc(1, sizeof(*p));
+
+        const uint8_t *data;
+        size_t         size;
+        error_t        err = mapFile(fileno(f), &data, &size);
+        if (err) goto fail;
+
+        if (size == 0) {
+                const uint8_t header[HEADER_SIZE] = {
+                    'B', 'B', 'G', 'R', RECORD_VERSION,
+                    h->rows, h->cols, h->num_to_win,
+                };
+                if (fwrite(header, HEADER_SIZE, 1, f) != 1) {
+                        err = errNew("failed to write the header.");
+                        goto fail;
+                }
+        } else {
+                struct record_header_t old;
+                uint64_t               num_games;
+
+                err = headerParse(data, size, &old);
+                if (!err && (old.rows != h->rows || old.cols != h->cols ||
+                             old.num_to_win != h->num_to_win)) {
+                        err = errNew("geometry mismatch: %dx%dx%d in file.",
+                                     old.rows, old.cols, old.num_to_win);
+                }
+                if (err) {
+                        munmap((void *)data, size);
+                        goto fail;
+                }
+
+                // drop a torn entry, so new entries stay aligned. the bots
+                // keep their ids.
+                size_t end = indexGames(data, size, NULL, &num_games, p->bots,
+                                        &p->num_bots);
+                munmap((void *)data, size);
+                if (end < size && ftruncate(fileno(f), end) == -1) {
+                        err = errNew("failed to truncate: %s", strerror(errno));
+                        goto fail;
+                }
+        }
+
+        p->f      = f;
+        p->header = *h;
+        *w        = p;
+        return OK;
+
+fail:
+        fclose(f);
+        botsFree(p->bots);
+        free(p);
+        return errEmitNote("failed to open record writer for %s.", path);
+}
+
+error_t
+recordWriterClose(struct record_writer_t *w)
+{
+        if (w == NULL) return OK;
+
+        int rc = fclose(w->f);
+        botsFree(w->bots);
+        free(w);
+        if (rc != 0) return errNew("failed to close: %s", strerror(errno));
+        return OK;
+}
+
+error_t
+recordWriterBot(struct record_writer_t *w, const char *name, int *id)
+{
+        for (int i = 0; i < w->num_bots; i++) {
+                if (w->bots[i] != NULL && strcmp(w->bots[i], name) == 0) {
+                        *id = i;
+                        return OK;
+                }
+        }
+
+        const size_t len = strlen(name);
+        if (w->num_bots == RECORD_MAX_BOTS) {
+                return errNew("too many bots for records: %d", w->num_bots);
+        }
+        if (len > UINT16_MAX) return errNew("bot name is too long.");
+
+        const uint8_t entry[BOT_SIZE] = {
+            RECORD_BOT, w->num_bots, len & 0xff, len >> 8,
+        };
+        if (fwrite(entry, BOT_SIZE, 1, w->f) != 1 ||
+            fwrite(name, 1, len, w->f) != len) {
+                return errNew("failed to write: %s", strerror(errno));
+        }
+
+        *id                    = w->num_bots;
+        w->bots[w->num_bots++] = sdsNew(name);
+        return OK;
+}
+
+error_t
+recordWrite(struct record_writer_t *w, int black, int white, int winner,
+            const uint8_t *moves, int num_moves)
+{
+        if (num_moves < 0 || num_moves > MOVES_MAX) {
+                return errNew("too many moves: %d", num_moves);
+        }
+        if (black < 0 || black >= w->num_bots || white < 0 ||
+            white >= w->num_bots) {
+                return errNew("undeclared bot ids: %d, %d", black, white);
+        }
+
+        // one buffer for the whole game, so stdio sees a single write.
+        uint8_t        buf[GAME_SIZE + (MOVES_MAX + 1) / 2];
+        const uint16_t info = num_moves | winnerCode(winner) << MOVES_BITS;
+
+        buf[0] = black;
+        buf[1] = white;
+        buf[2] = info & 0xff;
+        buf[3] = info >> 8;
+
+        uint8_t *packed = buf + GAME_SIZE;
+        for (int i = 0; i < num_moves; i += 2) {
+                const uint8_t hi = i + 1 < num_moves ? moves[i + 1] : 0;
+                if (moves[i] >= w->header.cols || hi >= w->header.cols) {
+                        return errNew("invalid column at move %d.", i);
+                }
+                packed[i / 2] = moves[i] | hi << 4;
+        }
+
+        const size_t size = GAME_SIZE + (num_moves + 1) / 2;
+        if (fwrite(buf, size, 1, w->f) != 1) {
+                return errNew("failed to write: %s", strerror(errno));
+        }
+        w->games++;
+        return OK;
+}
+
+// -----------------------------------------------------------------------------
+// reader.
+// -----------------------------------------------------------------------------
+
+error_t
+recordReaderOpen(const char *path, struct record_reader_t **r)
+{
+        int fd = open(path, O_RDONLY);
+        if (fd == -1) {
+                return errNew("failed to open %s: %s", path, strerror(errno));
+        }
+
+        const uint8_t *data;
+        size_t         size;
+        error_t        err = mapFile(fd, &data, &size);
+        close(fd);  // the mapping stays valid.
+        if (err) return errEmitNote("failed to read %s.", path);
+
+        struct record_header_t h;
+        err = headerParse(data, size, &h);
+        if (err) {
+                if (data != NULL) munmap((void *)data, size);
+                return errEmitNote("failed to read %s.", path);
+        }
+
+        // count first, then fill the index.
+        uint64_t num_games;
+        indexGames(data, size, NULL, &num_games, NULL, NULL);
+
+        struct record_reader_t *p = calloc(1, sizeof(*p));
+        p->data                   = data;
+        p->size                   = size;
+        p->header                 = h;
+        p->offsets = malloc((num_games > 0 ? num_games : 1) * sizeof(uint64_t));
+        indexGames(data, size, p->offsets, &p->num_games, p->bots,
+                   &p->num_bots);
+
+        *r = p;
+        return OK;
+}
+
+void
+recordReaderClose(struct record_reader_t *r)
+{
+        if (r == NULL) return;
+        munmap((void *)r->data, r->size);
+        botsFree(r->bots);
+        free(r->offsets);
+        free(r);
+}
+
+void
+recordGame(const struct record_reader_t *r, uint64_t i,
+           struct record_game_t *g)
+{
+        assert(i < r->num_games);
+        const uint8_t *p    = r->data + r->offsets[i];
+        const int      info = p[2] | p[3] << 8;
+
+        g->black     = p[0];
+        g->white     = p[1];
+        g->winner    = winnerOf(info >> MOVES_BITS);
+        g->num_moves = info & MOVES_MAX;
+        g->packed    = p + GAME_SIZE;
+}
+
+void
+recordMoves(const struct record_game_t *g, uint8_t *moves)
+{
+        const int n = g->num_moves;
+        for (int i = 0; i + 1 < n; i += 2) {
+                const uint8_t byte = g->packed[i / 2];
+                moves[i]           = byte & 0xf;
+                moves[i + 1]       = byte >> 4;
+        }
+        if (n % 2 == 1) moves[n - 1] = g->packed[n / 2] & 0xf;
+}
@@ -0,0 +1,134 @@
+#ifndef BB_RECORD_H_
+#define BB_RECORD_H_
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t
+#include <stdio.h>   // FILE
+
+// eva
+#include <adt/sds.h>
+#include <base/error.h>
+
+// bb
+#include "board.h"
+
+// -----------------------------------------------------------------------------
+// Binary game records.
+// -----------------------------------------------------------------------------
+//
+// A record file holds games of one board geometry. All integers are little
+// endian.
+//
+//   file header, 8 bytes:
+//     "BBGR", version, rows, cols, num_to_win
+//
+//   then entries, back to back. a bot, 4 + name_len bytes:
+//     RECORD_BOT    u8
+//     bot id        u8    the number of bots declared before.
+//     name_len      u16
+//     name          not terminated.
+//
+//   or a game, 4 + ceil(num_moves / 2) bytes:
+//     black bot id  u8
+//     white bot id  u8
+//     info          u16   num_moves | winner << 14, see RECORD_WINNER_*.
+//     moves         columns as 4-bit values, the first move in the low
+//                   nibble. the last byte is padded with zero.
+//
+// A bot is declared once per file, before its first game, so its id is stable
+// across the sessions appending to the file and readers map ids back to
+// names. A 6x7 game of 30 moves takes 19 bytes. Files are only appended to, so
+// a crash can at most leave a torn last entry, which readers skip.
+
+#define RECORD_VERSION  2
+#define RECORD_MAX_COLS 16   // columns must fit in 4 bits.
+#define RECORD_BOT      255  // first byte of a bot entry.
+#define RECORD_MAX_BOTS 255  // ids are below RECORD_BOT.
+
+// winner codes of the info field.
+#define RECORD_WINNER_NA    0  // unfinished.
+#define RECORD_WINNER_BLACK 1
+#define RECORD_WINNER_WHITE 2
+#define RECORD_WINNER_TIE   3
+
+struct record_header_t {
+        uint8_t rows;
+        uint8_t cols;
+        uint8_t num_to_win;
+};
+
+// A game of a reader. 'packed' points into the mapped file.
+struct record_game_t {
+        uint8_t        black;  // bot ids.
+        uint8_t        white;
+        enum player_t  winner;
+        int            num_moves;
+        const uint8_t *packed;
+};
+
+// Streaming writer, buffered by stdio.
+struct record_writer_t {
+        FILE                  *f;
+        struct record_header_t header;
+        uint64_t               games;  // written by this writer.
+
+        sds_t bots[RECORD_MAX_BOTS];  // owned. names by id. [num_bots]
+        int   num_bots;               // declared in the file.
+};
+
+// Memory-mapped reader with an index of the game offsets.
+struct record_reader_t {
+        const uint8_t         *data;
+        size_t                 size;
+        struct record_header_t header;
+        uint64_t              *offsets;  // [num_games]
+        uint64_t               num_games;
+
+        sds_t bots[RECORD_MAX_BOTS];  // owned. names by id. [num_bots]
+        int   num_bots;
+};
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+// Opens 'path' for appending, creating it if needed. An existing file must have
+// the geometry of 'h'.
+extern error_t recordWriterOpen(const char *path,
+                                const struct record_header_t *h,
+                                _out_ struct record_writer_t **w);
+
+// Flushes and closes 'w'. 'w' is freed even on error.
+extern error_t recordWriterClose(struct record_writer_t *w);
+
+// Returns in 'id' the id of the bot 'name' in the file of 'w', declaring it if
+// the file has none of that name yet.
+extern error_t recordWriterBot(struct record_writer_t *w, const char *name,
+                               _out_ int *id);
+
+// Appends a game. 'black' and 'white' are ids of recordWriterBot and 'winner'
+// is enum player_t.
+extern error_t recordWrite(struct record_writer_t *w, int black, int white,
+                           int winner, const uint8_t *moves, int num_moves);
+
+// Maps 'path' and indexes its games.
+extern error_t recordReaderOpen(const char *path,
+                                _out_ struct record_reader_t **r);
+extern void    recordReaderClose(struct record_reader_t *r);
+
+// Fills 'g' with the game 'i' of 'r', in [0, r->num_games). The names of its
+// bots are r->bots[g->black] and r->bots[g->white].
+extern void recordGame(const struct record_reader_t *r, uint64_t i,
+                       _out_ struct record_game_t *g);
+
+// Unpacks the columns of 'g' into 'moves', which holds g->num_moves entries.
+extern void recordMoves(const struct record_game_t *g, _out_ uint8_t *moves);
+
+// Returns the column of move 'i' of 'g'.
+static inline int
+recordMove(const struct record_game_t *g, int i)
+{
+        return (g->packed[i / 2] >> (4 * (i % 2))) & 0xf;
+}
+
+#endif  // BB_RECORD_H_
@@ -0,0 +1,158 @@
+#include "render.h"
+
+#include <assert.h>
+#include <ncurses.h>
+#include <stdlib.h>
+#include <string.h>  // strcmp
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define UNKNOWN -2
+
+// screen position of the stone of cell ('row', 'col').
+#define CELL_Y(r, row) ((r)->top + 1 + 2 * (row))
+#define CELL_X(r, col) ((r)->left + 2 + 4 * (col))
+
+// screen row of the cursor, under the board.
+#define CURSOR_Y(r) ((r)->top + 1 + 2 * (r)->rows)
+
+static void
+drawBorders(struct render_t *r)
+{
+        for (int row = 0; row <= r->rows; row++) {
+                mvaddch(r->top + 2 * row, r->left, '+');
+                for (int col = 0; col < r->cols; col++) addstr("---+");
+        }
+        for (int row = 0; row < r->rows; row++) {
+                for (int col = 0; col <= r->cols; col++) {
+                        mvaddch(CELL_Y(r, row), r->left + 4 * col, '|');
+                }
+        }
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+struct render_t *
+renderNew(int rows, int cols, int top, int left)
+{
+        struct render_t *r = calloc(1, sizeof(*r));
+        r->rows            = rows;
+        r->cols            = cols;
+        r->top             = top;
+        r->left            = left;
+        r->cells           = malloc(2 * rows * cols * sizeof(int));
+        r->cell_attrs      = r->cells + rows * cols;
+
+        renderInvalidate(r);
+        return r;
+}
+
+void
+renderFree(struct render_t *r)
+{
+        if (r == NULL) return;
+        for (int i = 0; i < RENDER_NUM_LINES; i++) sdsFree(r->lines[i]);
+        free(r->cells);
+        free(r);
+}
+
+void
+renderInvalidate(struct render_t *r)
+{
+        erase();
+
+        r->borders = 0;
+        r->dirty   = 1;
+        r->cursor  = UNKNOWN;
+        for (int i = 0; i < RENDER_NUM_LINES; i++) {
+                sdsFree(r->lines[i]);
+                r->lines[i]      = NULL;
+                r->line_attrs[i] = UNKNOWN;
+        }
+        for (int i = 0; i < r->rows * r->cols; i++) {
+                r->cells[i]      = UNKNOWN;
+                r->cell_attrs[i] = UNKNOWN;
+        }
+}
+
+void
+renderLine(struct render_t *r, int line, int attr, const char *text)
+{
+        assert(line >= 0 && line < RENDER_NUM_LINES);
+        if (r->lines[line] != NULL && r->line_attrs[line] == attr &&
+            strcmp(r->lines[line], text) == 0) {
+                return;
+        }
+
+        move(line, 0);
+        clrtoeol();
+        attron(attr);
+        addstr(text);
+        attroff(attr);
+
+        if (r->lines[line] == NULL) {
+                r->lines[line] = sdsEmpty();
+        } else {
+                sdsClear(r->lines[line]);
+        }
+        sdsCatPrintf(&r->lines[line], "%s", text);
+        r->line_attrs[line] = attr;
+        r->dirty            = 1;
+}
+
+void
+renderCell(struct render_t *r, int row, int col, int v, int attr)
+{
+        const int i = row * r->cols + col;
+        if (r->cells[i] == v && r->cell_attrs[i] == attr) return;
+
+        const chtype ch = v == PLAYER_BLACK   ? 'x'
+                          : v == PLAYER_WHITE ? 'o'
+                                              : ' ';
+        mvaddch(CELL_Y(r, row), CELL_X(r, col), ch | attr);
+
+        r->cells[i]      = v;
+        r->cell_attrs[i] = attr;
+        r->dirty         = 1;
+}
+
+void
+renderCursor(struct render_t *r, int col)
+{
+        if (r->cursor == col) return;
+
+        const int y = CURSOR_Y(r);
+        if (r->cursor == UNKNOWN) {
+                move(y, 0);
+                clrtoeol();
+                move(y + 1, 0);
+                clrtoeol();
+        } else if (r->cursor != -1) {
+                mvaddch(y, CELL_X(r, r->cursor), ' ');
+                mvaddch(y + 1, CELL_X(r, r->cursor), ' ');
+        }
+        if (col != -1) {
+                mvaddch(y, CELL_X(r, col), '^');
+                mvaddch(y + 1, CELL_X(r, col), '|');
+        }
+
+        r->cursor = col;
+        r->dirty  = 1;
+}
+
+void
+renderFlush(struct render_t *r)
+{
+        if (!r->borders) {
+                drawBorders(r);
+                r->borders = 1;
+        }
+        if (r->dirty) {
+                refresh();
+                r->dirty = 0;
+        }
+}
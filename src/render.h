@@ -0,0 +1,68 @@
+#ifndef BB_RENDER_H_
+#define BB_RENDER_H_
+
+// eva
+#include <adt/sds.h>
+
+// bb
+#include "board.h"
+
+// -----------------------------------------------------------------------------
+// Incremental rendering of the runner screen.
+// -----------------------------------------------------------------------------
+//
+// The renderer keeps the last drawn frame: the status lines, the stones and the
+// cursor column. Setters only touch the curses screen where the new value
+// differs, and renderFlush sends the batch to the terminal with one refresh, so
+// a move costs a few bytes of output rather than a redraw of the board.
+//
+// Screen layout:
+//
+//   status lines, from row 0.
+//   ...
+//   +---+---+   <- 'top', from column 'left'.
+//   | x | o |
+//   +---+---+
+//     ^         <- cursor rows.
+//     |
+
+#define RENDER_NUM_LINES 3
+
+struct render_t {
+        int rows;  // of the board.
+        int cols;
+        int top;   // screen position of the board.
+        int left;
+
+        int borders;  // 1 if the borders are on the screen.
+        int dirty;    // 1 if the screen changed since the last flush.
+
+        // the drawn frame. -2 (or NULL for lines) means unknown.
+        int   cursor;  // column, -1 if hidden.
+        sds_t lines[RENDER_NUM_LINES];
+        int   line_attrs[RENDER_NUM_LINES];
+        int  *cells;       // [rows * cols] stones, PLAYER_*.
+        int  *cell_attrs;  // [rows * cols]
+};
+
+// The curses screen must be initialized before any other call.
+extern struct render_t *renderNew(int rows, int cols, int top, int left);
+extern void             renderFree(struct render_t *r);
+
+// Clears the screen and forgets the drawn frame, e.g., after a resize.
+extern void renderInvalidate(struct render_t *r);
+
+// Sets a status line, drawn with the curses attributes 'attr'.
+extern void renderLine(struct render_t *r, int line, int attr,
+                       const char *text);
+
+// Sets the stone 'v' of a cell, drawn with the curses attributes 'attr'.
+extern void renderCell(struct render_t *r, int row, int col, int v, int attr);
+
+// Moves the cursor to column 'col'; -1 hides it.
+extern void renderCursor(struct render_t *r, int col);
+
+// Draws the pending changes with a single refresh.
+extern void renderFlush(struct render_t *r);
+
+#endif  // BB_RENDER_H_
@@ -0,0 +1,222 @@
+#include "replay.h"
+
+#include <sched.h>   // sched_yield
+#include <stdlib.h>  // calloc
+#include <string.h>  // memcpy
+
+// mlvm
+#include "vm.h"
+
+// bb
+#include "encode.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define RELAXED memory_order_relaxed
+
+static struct replay_slot_t *
+slotAt(struct replay_t *r, uint64_t i)
+{
+        return (struct replay_slot_t *)(r->slots + i * r->slot_size);
+}
+
+static void
+replayPut(struct replay_t *r, const struct selfplay_sample_t *sample)
+{
+        const uint64_t        t    = atomic_fetch_add(&r->head, 1);
+        struct replay_slot_t *slot = slotAt(r, t % r->capacity);
+
+        // the producer of the previous lap may still be writing the slot.
+        // rare unless the ring is tiny, and that producer may be preempted.
+        const uint64_t prev = t < r->capacity ? 0 : 2 * (t - r->capacity) + 2;
+        while (atomic_load_explicit(&slot->seq, memory_order_acquire) != prev) {
+                sched_yield();
+        }
+
+        atomic_store_explicit(&slot->seq, 2 * t + 1, RELAXED);
+        atomic_thread_fence(memory_order_release);
+        memcpy(slot->sample, sample, r->stride);
+        atomic_store_explicit(&slot->seq, 2 * t + 2, memory_order_release);
+}
+
+// copies a random sample held to 'r->sample'. returns 0 if it raced a
+// producer.
+static int
+replayGet(struct replay_t *r, struct rng64_t *rng, uint64_t size)
+{
+        struct replay_slot_t *slot = slotAt(r, rng64NextUint64(rng) % size);
+
+        const uint64_t seq =
+            atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == 0 || seq % 2 == 1) return 0;
+
+        memcpy(r->sample, slot->sample, r->stride);
+        atomic_thread_fence(memory_order_acquire);
+        return atomic_load_explicit(&slot->seq, RELAXED) == seq;
+}
+
+// encodes 'r->sample' into one row of x, policy and value.
+static void
+replayEncode(struct replay_t *r, uint8_t mirror, _out_ float *x,
+             _out_ float *policy, _out_ float *value)
+{
+        struct selfplay_sample_t *s    = r->sample;
+        const int                 cols = r->opts.cols;
+
+        boardRestore(r->scratch, selfplaySampleStones(s));
+        encodeBoards(&r->scratch, 1, &mirror, x);
+        for (int c = 0; c < cols; c++) {
+                policy[c] = s->policy[mirror ? cols - 1 - c : c];
+        }
+        *value = (s->result + 1) / 2.0f;
+}
+
+// returns in 'data' the f32 data of the tensor 'td' of 'vm', which must have
+// the shape [batch, cols].
+static error_t
+tensorRows(struct vm_t *vm, int td, int batch, int cols, const char *name,
+           _out_ float **data)
+{
+        struct shape_t *sp;
+        error_t         err = vmTensorInfo(vm, td, /*dtype=*/NULL, &sp);
+        if (err) return errEmitNote("failed to grab the %s shape.", name);
+
+        if (sp->rank != 2 || sp->dims[0] != batch || sp->dims[1] != cols) {
+                return errNew("expect %s of shape [%d, %d].", name, batch,
+                              cols);
+        }
+
+        err = vmTensorData(vm, td, (void **)data);
+        if (err) return errEmitNote("failed to get the %s data.", name);
+        return OK;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+error_t
+replayNew(const struct replay_opts_t *opts, struct replay_t **out)
+{
+        if (opts->cols > UINT8_MAX) {
+                return errNew("too many columns for samples: %d", opts->cols);
+        }
+
+        struct board_t *scratch =
+            boardNew(opts->rows, opts->cols, opts->num_to_win, 1);
+        const size_t stride = selfplaySampleSize(scratch);
+        if (stride == 0) {
+                boardFree(scratch);
+                return errNew("board too large for samples: %dx%d",
+                              opts->rows, opts->cols);
+        }
+
+        const size_t slot_size =
+            (sizeof(struct replay_slot_t) + stride + 7) & ~(size_t)7;
+        const uint64_t capacity = opts->bytes / slot_size;
+        if (capacity == 0) {
+                boardFree(scratch);
+                return errNew("%zu bytes hold no sample of %zu bytes.",
+                              opts->bytes, slot_size);
+        }
+
+        uint8_t *slots = calloc(capacity, slot_size);
+        if (slots == NULL) {
+                boardFree(scratch);
+                return errNew("failed to allocate %zu bytes.", opts->bytes);
+        }
+
+        struct replay_t *r = calloc(1, sizeof(*r));
+        r->opts            = *opts;
+        r->slots           = slots;
+        r->slot_size       = slot_size;
+        r->stride          = stride;
+        r->capacity        = capacity;
+        r->scratch         = scratch;
+        r->sample          = malloc(stride);
+        atomic_init(&r->head, 0);
+        atomic_init(&r->retries, 0);
+
+        *out = r;
+        return OK;
+}
+
+void
+replayFree(struct replay_t *r)
+{
+        if (r == NULL) return;
+        boardFree(r->scratch);
+        free(r->sample);
+        free(r->slots);
+        free(r);
+}
+
+void
+replayAppend(struct replay_t *r, const struct selfplay_sample_t *samples,
+             int n)
+{
+        const uint8_t *p = (const uint8_t *)samples;
+        for (int i = 0; i < n; i++, p += r->stride) {
+                replayPut(r, (const struct selfplay_sample_t *)p);
+        }
+}
+
+error_t
+replaySample(struct replay_t *r, struct rng64_t *rng, int n, float *x,
+             float *policy, float *value)
+{
+        const uint64_t head = atomic_load(&r->head);
+        const uint64_t size = head < r->capacity ? head : r->capacity;
+        if (size == 0) return errNew("no samples to draw.");
+
+        const int x_size = encodeSize(r->scratch);
+        const int cols   = r->opts.cols;
+
+        for (int i = 0; i < n; i++) {
+                while (!replayGet(r, rng, size)) {
+                        atomic_fetch_add_explicit(&r->retries, 1, RELAXED);
+                }
+
+                const uint8_t mirror = r->opts.mirror &&
+                                       (rng64NextUint64(rng) & 1);
+                replayEncode(r, mirror, x + (size_t)i * x_size,
+                             policy + (size_t)i * cols, value + i);
+        }
+        return OK;
+}
+
+error_t
+replaySampleBatch(struct replay_t *r, struct rng64_t *rng, struct vm_t *vm,
+                  int x, int policy, int value)
+{
+        struct shape_t *x_sp;
+        error_t         err = vmTensorInfo(vm, x, /*dtype=*/NULL, &x_sp);
+        if (err) return errEmitNote("failed to grab the x shape.");
+
+        const int batch = x_sp->dims[0];
+        float    *x_data;
+        float    *policy_data;
+        float    *value_data;
+
+        err = tensorRows(vm, x, batch, encodeSize(r->scratch), "x", &x_data);
+        if (err) return err;
+        err = tensorRows(vm, policy, batch, r->opts.cols, "policy",
+                         &policy_data);
+        if (err) return err;
+        err = tensorRows(vm, value, batch, 1, "value", &value_data);
+        if (err) return err;
+
+        return replaySample(r, rng, batch, x_data, policy_data, value_data);
+}
+
+void
+replayStats(struct replay_t *r, struct replay_stats_t *stats)
+{
+        stats->appended = atomic_load(&r->head);
+        stats->capacity = r->capacity;
+        stats->size     = stats->appended < r->capacity ? stats->appended
+                                                        : r->capacity;
+        stats->retries  = atomic_load(&r->retries);
+}
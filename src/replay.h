@@ -0,0 +1,112 @@
+#ifndef BB_REPLAY_H_
+#define BB_REPLAY_H_
+
+#include <stdatomic.h>
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+#include <rng/srng64.h>
+
+// bb
+#include "board.h"
+#include "selfplay.h"
+
+// -----------------------------------------------------------------------------
+// Replay buffer.
+// -----------------------------------------------------------------------------
+//
+// A bounded ring of self-play samples shared by the producers, e.g.,
+// selfplayRun workers, and a trainer. Once full, each new sample overwrites
+// the oldest one.
+//
+// Producers never lock: each takes a ticket from one counter and writes the
+// slot 'ticket % capacity'. A slot holds a sequence number, odd while being
+// written, so the trainer copies a sample out and keeps it only if the number
+// did not change meanwhile; otherwise it draws another slot. The only wait is
+// for a producer a full lap behind on the same slot.
+//
+// The trainer draws samples uniformly, with replacement, and encodes them
+// with encodeBoards straight into the rows of its tensors:
+//
+//   x       [batch, ENCODE_PLANES * rows * cols]
+//   policy  [batch, cols]  visit distribution; the target of a softmax
+//                          cross-entropy loss, e.g., BB_TAG_SCEL on m->y.
+//   value   [batch, 1]     result for the side to move: 1 win, 0.5 draw,
+//                          0 loss. the scale of the value of nnDecode, for
+//                          a separate value loss.
+
+// A ring slot. Private to replay.c. 'seq' is 0 while empty, then 2t+1 while
+// ticket t is written and 2t+2 after. Slots are 'slot_size' bytes apart, e.g.,
+// 56 bytes on 6x7.
+struct replay_slot_t {
+        _Atomic(uint64_t) seq;
+        uint8_t           sample[];  // a self-play sample of 'stride' bytes.
+};
+
+struct replay_opts_t {
+        int rows;
+        int cols;
+        int num_to_win;
+
+        size_t bytes;   // hard cap of the slots.
+        int    mirror;  // 1 to mirror half of the samples drawn, at random.
+};
+
+struct replay_stats_t {
+        uint64_t appended;  // samples appended since creation.
+        uint64_t size;      // samples held.
+        uint64_t capacity;  // slots.
+        uint64_t retries;   // draws that raced a producer.
+};
+
+struct replay_t {
+        struct replay_opts_t  opts;
+        uint8_t *slots;      // owned. [capacity] of 'slot_size' bytes.
+        size_t   slot_size;  // seq and sample, 8-byte aligned.
+        size_t   stride;     // see selfplaySampleSize.
+        uint64_t capacity;   // bytes / slot_size.
+
+        _Atomic(uint64_t) head;     // tickets taken.
+        _Atomic(uint64_t) retries;  //
+
+        struct board_t           *scratch;  // owned. decodes the samples drawn.
+        struct selfplay_sample_t *sample;   // owned. copy of the sample drawn.
+};
+
+struct vm_t;
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+// Fails if 'opts->bytes' does not fit one sample or the board cannot be
+// snapshotted.
+extern error_t replayNew(const struct replay_opts_t *opts,
+                         _out_ struct replay_t **r);
+extern void    replayFree(struct replay_t *r);
+
+// Appends 'n' samples, packed at the stride of selfplaySampleSize. Thread-safe
+// and lock-free.
+extern void replayAppend(struct replay_t *r,
+                         const struct selfplay_sample_t *samples, int n);
+
+// Draws 'n' samples into 'x', 'policy' and 'value', which hold n rows of the
+// shapes above. Fails if the buffer is empty. One thread at a time, as it
+// uses 'scratch' and 'sample'.
+extern error_t replaySample(struct replay_t *r, struct rng64_t *rng, int n,
+                            _out_ float *x, _out_ float *policy,
+                            _out_ float *value);
+
+// Same as replaySample, but fills all rows of the f32 tensors 'x', 'policy'
+// and 'value' of 'vm', e.g., m->x and m->y of a bb_seq_module_t for the
+// first two.
+extern error_t replaySampleBatch(struct replay_t *r, struct rng64_t *rng,
+                                 struct vm_t *vm, int x, int policy,
+                                 int value);
+
+extern void replayStats(struct replay_t *r,
+                        _out_ struct replay_stats_t *stats);
+
+#endif  // BB_REPLAY_H_
@@ -1,10 +1,20 @@
 #include "runner.h"
 
+#include <errno.h>
 #include <ncurses.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>  // strerror
+#include <unistd.h>  // pipe
 
 // eva
 #include <base/error.h>
 
+// bb
+#include "clock.h"
+#include "render.h"
+#include "trace.h"
+
 // -----------------------------------------------------------------------------
 // colors
 // -----------------------------------------------------------------------------
@@ -14,11 +24,26 @@
 #define COLOR_PREV_STONE 3
 #define COLOR_BOT        4
 
+// -----------------------------------------------------------------------------
+// status lines
+// -----------------------------------------------------------------------------
+
+#define LINE_HELP  0
+#define LINE_MSG   1
+#define LINE_STATS 2
+
 // -----------------------------------------------------------------------------
 // error messages
 // -----------------------------------------------------------------------------
 
 #define ERR_MSG_COL_FULL "col is full, try again."
+#define ERR_MSG_TRACE    "failed to write " TRACE_MOVE_PATH "."
+
+// -----------------------------------------------------------------------------
+// timeline of the last bot move. see src/trace.h.
+// -----------------------------------------------------------------------------
+
+#define TRACE_MOVE_PATH "move_trace.json"
 
 // -----------------------------------------------------------------------------
 // winner message.
@@ -40,11 +65,12 @@
 static void
 initScr()
 {
-        initscr();             // start curses mode
-        raw();                 // line buffering disabled
-        keypad(stdscr, TRUE);  // get F1, F2 etc..
-        noecho();              // don't echo() while we do getch
-        curs_set(0);           // sets the cursor state to invisible
+        initscr();              // start curses mode
+        raw();                  // line buffering disabled
+        keypad(stdscr, TRUE);   // get F1, F2 etc..
+        noecho();               // don't echo() while we do getch
+        curs_set(0);            // sets the cursor state to invisible
+        nodelay(stdscr, TRUE);  // getch returns ERR without input
 
         start_color();
         init_pair(COLOR_WINNER, COLOR_BLACK, COLOR_GREEN);
@@ -60,10 +86,49 @@ finalizeScr()
         endwin();
 }
 
+// -----------------------------------------------------------------------------
+// bot thread.
+// -----------------------------------------------------------------------------
+//
+// botPlay runs on its own thread with a copy of the board, so the event loop
+// keeps serving keys and timers while the bot thinks. When done, the thread
+// writes one byte to the pipe the loop polls.
+
+struct bot_job_t {
+        struct bot_t   *bot;
+        struct board_t *b;  // owned. copy of the game board.
+        int             prev_r;
+        int             prev_c;
+        int             fd;        // write end of the pipe.
+        uint64_t        start_ns;  // when the job started.
+        pthread_t       tid;
+
+        // results.
+        error_t err;
+        int     r;
+        int     c;
+};
+
+static void *
+botJobRun(void *arg)
+{
+        struct bot_job_t *job = arg;
+        job->err = botPlay(job->bot, job->b, job->prev_r, job->prev_c, &job->r,
+                           &job->c);
+
+        // wakes up the event loop.
+        while (write(job->fd, "", 1) == -1 && errno == EINTR) {
+        }
+        return NULL;
+}
+
 // -----------------------------------------------------------------------------
 // runner.
 // -----------------------------------------------------------------------------
 
+// period of the ui refresh while a clock is shown.
+#define FRAME_MS 100
+
 error_t
 runner(struct board_t *b, struct bot_t *bot_black, struct bot_t *bot_white,
        int *final_winner)
@@ -79,90 +144,114 @@ runner(struct board_t *b, struct bot_t *bot_black, struct bot_t *bot_white,
         enum player_t color    = PLAYER_BLACK;  // color for next stone.
         int           winner   = PLAYER_NA;     // winner of the game.
         char         *err_msg  = NULL;          // recoverable errors.
+        struct bot_t *last_bot = NULL;          // bot placing the last stone.
+        sds_t         summary  = sdsEmpty();    // stats of last_bot.
         error_t       err      = OK;
 
+        // copy of the stats of last_bot, taken once its thread is joined:
+        // the bot clears and refills its own on its next move, which may
+        // already run, e.g., if it plays both colors.
+        struct bot_stats_t last_stats;
+
+        // event loop.
+        int              pipe_fds[2];            // bot thread -> loop.
+        struct bot_job_t job          = {0};
+        int              bot_running  = 0;  // 1 if job is running.
+        int              keys_to_quit = 2;  // once there is a winner.
+
         // local vars. used in small context.
         int ch;   // input for getch().
         int row;  // track the current row to put, deduced by col.
 
+        if (pipe(pipe_fds) == -1) {
+                sdsFree(summary);
+                return errNew("failed to create pipe: %s", strerror(errno));
+        }
+        job.b  = boardClone(b);
+        job.fd = pipe_fds[1];
+
         initScr();
 
+        // only the cells, lines and cursor changed by a move are redrawn.
+        struct render_t *render =
+            renderNew(b->rows, b->cols, /*top=*/LINE_MSG + row_margin,
+                      col_margin);
+        sds_t msg = sdsEmpty();  // text of LINE_MSG.
+
         while (1) {
-                int cur_row = 0;
                 int v;
 
-                // print instructions.
-                mvprintw(cur_row++, 0,
-                         "Use <- or -> to select column and space to place new "
-                         "stone (q to quit).");
+                struct bot_t *bot =
+                    color == PLAYER_BLACK ? bot_black : bot_white;
+
+                int found_winner   = winner != PLAYER_NA;
+                int bot_is_playing = bot != NULL;
+
+                // start the bot on its turn.
+                if (!found_winner && bot_is_playing && !bot_running) {
+                        boardCopy(job.b, b);
+                        job.bot      = bot;
+                        job.prev_r   = prev_row;
+                        job.prev_c   = prev_col;
+                        job.start_ns = nowNs();
+                        if (pthread_create(&job.tid, NULL, botJobRun, &job)) {
+                                err = errNew("failed to start the bot.");
+                                goto exit;
+                        }
+                        bot_running = 1;
+                }
+
+                renderLine(render, LINE_HELP, 0,
+                           "Use <- or -> to select column and space to place "
+                           "new stone (q to quit).");
 
                 // for all msgs.
                 //
                 // four possible types (exclusive)
                 // - winner
                 // - error message
-                // - info message
+                // - info message, with the clock of a thinking bot.
                 // - (default) absent
-                //
-                // note: It will have sufficient margin to plot board. We will
-                // not increase cur_row here.
                 {
-                        // this is an optimization. we clear the line
-                        // for error message, etc rather than clear the
-                        // whole screen.
-                        move(cur_row, 0);
-                        clrtoeol();
+                        int attr = 0;
+                        sdsClear(msg);
 
                         if (winner != PLAYER_NA) {
                                 assert(err_msg == NULL);
-                                assert(row_margin > 0);
-
-                                attron(COLOR_PAIR(COLOR_WINNER));
-                                mvprintw(cur_row, 0,
-                                         " winner is: %s. press any key twice "
-                                         "to quit",
-                                         WINNER_STR(winner));
-                                attroff(COLOR_PAIR(COLOR_WINNER));
+
+                                attr = COLOR_PAIR(COLOR_WINNER);
+                                sdsCatPrintf(&msg,
+                                             " winner is: %s. press any key "
+                                             "twice to quit",
+                                             WINNER_STR(winner));
                         } else if (err_msg != NULL) {
                                 assert(winner == PLAYER_NA);
-                                attron(COLOR_PAIR(COLOR_ERROR));
-                                mvprintw(cur_row, 0, " error: %s", err_msg);
-                                attroff(COLOR_PAIR(COLOR_ERROR));
+                                attr = COLOR_PAIR(COLOR_ERROR);
+                                sdsCatPrintf(&msg, " error: %s", err_msg);
                                 err_msg = NULL;
-                        } else if (color == PLAYER_BLACK && bot_black != NULL) {
+                        } else if (bot_is_playing) {
                                 assert(winner == PLAYER_NA);
-                                assert(err_msg == NULL);
-                                attron(COLOR_PAIR(COLOR_BOT));
-                                mvprintw(cur_row, 0, "%s: %s", bot_black->name,
-                                         bot_black->msg);
-                                attroff(COLOR_PAIR(COLOR_BOT));
-                        } else if (color == PLAYER_WHITE && bot_white != NULL) {
-                                assert(winner == PLAYER_NA);
-                                assert(err_msg == NULL);
-                                attron(COLOR_PAIR(COLOR_BOT));
-                                mvprintw(cur_row, 0, "%s: %s", bot_white->name,
-                                         bot_white->msg);
-                                attroff(COLOR_PAIR(COLOR_BOT));
+                                assert(bot_running);
+                                attr = COLOR_PAIR(COLOR_BOT);
+                                sdsCatPrintf(&msg, "%s: %s (%.1fs)", bot->name,
+                                             bot->msg,
+                                             (nowNs() - job.start_ns) / 1e9);
                         } else {
                                 // no action.
                         }
+                        renderLine(render, LINE_MSG, attr, msg);
                 }
 
-                // have some blank lines.
-                cur_row += row_margin;
+                // stats of the last bot move, below the message line.
+                sdsClear(summary);
+                if (last_bot != NULL) {
+                        sdsCatPrintf(&summary, "%s: ", last_bot->name);
+                        botStatsSummary(&last_stats, &summary);
+                }
+                renderLine(render, LINE_STATS, 0, summary);
 
-                // print the board.
+                // the board.
                 for (int r = 0; r < b->rows; r++) {
-                        if (r == 0) {
-                                // print the header
-                                mvprintw(cur_row, col_margin, "+");
-                                for (int c = 0; c < b->cols; c++) {
-                                        printw("---+");
-                                }
-                                cur_row++;
-                        }
-
-                        mvprintw(cur_row++, col_margin, "|");
                         for (int c = 0; c < b->cols; c++) {
                                 err = boardGet(b, r, c, &v);
                                 if (err) {
@@ -170,98 +259,54 @@ runner(struct board_t *b, struct bot_t *bot_black, struct bot_t *bot_white,
                                 }
 
                                 int set_color = prev_row == r && prev_col == c;
-
-                                if (set_color) {
-                                        printw(" ");
-
-                                        attron(COLOR_PAIR(COLOR_PREV_STONE));
-                                        assert(v != 0);
-                                        if (v == PLAYER_BLACK) {
-                                                printw("x");
-                                        } else {
-                                                assert(v == PLAYER_WHITE);
-                                                printw("o");
-                                        }
-                                        attroff(COLOR_PAIR(COLOR_PREV_STONE));
-
-                                        printw(" |");
-                                } else {
-                                        if (v == 0) {
-                                                printw("   |");
-                                        } else if (v == PLAYER_BLACK) {
-                                                printw(" x |");
-                                        } else {
-                                                assert(v == PLAYER_WHITE);
-                                                printw(" o |");
-                                        }
-                                }
-                        }
-                        mvprintw(cur_row++, col_margin, "+");
-                        for (int c = 0; c < b->cols; c++) {
-                                printw("---+");
+                                assert(!set_color || v != 0);
+                                renderCell(render, r, c, v,
+                                           set_color
+                                               ? COLOR_PAIR(COLOR_PREV_STONE)
+                                               : 0);
                         }
                 }
 
-                // handle player/bot logic now.
+                // the cursor is only shown while waiting for a human.
+                renderCursor(render,
+                             found_winner || bot_is_playing ? -1 : col);
+                renderFlush(render);
+
+                // wait for keys, the bot, or the next frame of its clock.
+                // otherwise, the loop sleeps until a key comes.
+                struct pollfd fds[2] = {
+                    {.fd = STDIN_FILENO, .events = POLLIN},
+                    {.fd = pipe_fds[0], .events = POLLIN},
+                };
+                int timeout = -1;
+                if (bot_running) {
+                        uint64_t ms = (nowNs() - job.start_ns) / 1000000;
+                        timeout     = FRAME_MS - ms % FRAME_MS;
+                }
 
-                struct bot_t *bot =
-                    color == PLAYER_BLACK ? bot_black : bot_white;
+                int n = poll(fds, 2, timeout);
+                if (n == -1 && errno != EINTR) {
+                        err = errNew("failed to poll: %s", strerror(errno));
+                        goto exit;
+                }
 
-                int found_winner   = winner != PLAYER_NA;
-                int bot_is_playing = bot != NULL;
+                // the bot is done.
+                if (n > 0 && (fds[1].revents & POLLIN)) {
+                        char byte;
+                        if (read(pipe_fds[0], &byte, 1) != 1) {
+                                err = errNew("failed to read the pipe.");
+                                goto exit;
+                        }
+                        pthread_join(job.tid, NULL);
+                        bot_running = 0;
 
-#define HIDE_CURSOR_POINT()                  \
-        do {                                 \
-                move(cur_row++, col_margin); \
-                clrtoeol();                  \
-                move(cur_row++, col_margin); \
-                clrtoeol();                  \
-                refresh();                   \
-        } while (0)
-
-#define SHOW_CURSOR_POINT()                           \
-        do {                                          \
-                mvprintw(cur_row++, col_margin, " "); \
-                for (int c = 0; c < b->cols; c++) {   \
-                        if (c == col) {               \
-                                printw(" ^  ");       \
-                        } else {                      \
-                                printw("    ");       \
-                        }                             \
-                }                                     \
-                mvprintw(cur_row++, col_margin, " "); \
-                for (int c = 0; c < b->cols; c++) {   \
-                        if (c == col) {               \
-                                printw(" |  ");       \
-                        } else {                      \
-                                printw("    ");       \
-                        }                             \
-                }                                     \
-                refresh();                            \
-        } while (0)
-
-                if (found_winner) {
-                        HIDE_CURSOR_POINT();
-
-                        // we have a winner. give users some time to check the
-                        // result and then quit.
-                        getch();
-                        getch();   // get another key to avoid accident.
-                        ch = 'q';  // quit. fall through.
-                } else if (bot_is_playing) {
-                        HIDE_CURSOR_POINT();
-
-                        assert(winner == PLAYER_NA);
-                        int r, c;  // dont pollute the pos for the UI.
-                        err = bot->bot_fn(b, bot->data, prev_row, prev_col, &r,
-                                          &c);
-                        if (err) {
+                        if (job.err) {
                                 err = errEmitNote(
                                     "unexpected error during playing bot.");
                                 goto exit;
                         }
 
-                        err = boardSet(b, r, c, color, 0);
+                        err = boardSet(b, job.r, job.c, color, 0);
                         if (OK != err) {
                                 err = errEmitNote(
                                     "unexpected error during placing stone for "
@@ -269,73 +314,108 @@ runner(struct board_t *b, struct bot_t *bot_black, struct bot_t *bot_white,
                                 goto exit;
                         }
 
-                        prev_row = r;
-                        prev_col = c;
+                        prev_row   = job.r;
+                        prev_col   = job.c;
+                        last_bot   = bot;
+                        last_stats = job.bot->stats;
 
                         color =
                             color == PLAYER_BLACK ? PLAYER_WHITE : PLAYER_BLACK;
                         winner = boardWinner(b);
 
-                        // we are done here. either, we found a winner and plot
-                        // the winning move in next iteration and quit, or we
-                        // start next iteration.
-                        continue;
-
-                } else {
-                        // human, plot cursor point and check keystroke.
-                        SHOW_CURSOR_POINT();
+                        // the bot thread is done, so the rings are quiet:
+                        // dump the move, in place of the previous one, and
+                        // start the next one afresh. no-op unless built with
+                        // TRACE=1.
+                        if (TRACE_DUMP(TRACE_MOVE_PATH) != 0 &&
+                            winner == PLAYER_NA) {
+                                err_msg = ERR_MSG_TRACE;
+                        }
+                        TRACE_CLEAR();
 
-                        ch = getch();
+                        // either, we found a winner and plot the winning move
+                        // in next iteration, or the next player moves.
+                        continue;
                 }
 
-#undef HIDE_CURSOR_POINT
-#undef SHOW_CURSOR_POINT
-
-                switch (ch) {
-                case CTRL('c'):
-                case 'q':
-                        refresh();
-                        goto exit;
-                case KEY_LEFT:
-                        col--;
-                        if (col < 0) {
-                                col = b->cols - 1;
+                // all pending keys, until the human moves. a signal (n ==
+                // -1) may also bring one, e.g., KEY_RESIZE.
+                int moved = 0;
+                while (!moved && (ch = getch()) != ERR) {
+                        if (ch == CTRL('c') || ch == 'q') goto exit;
+                        if (ch == KEY_RESIZE) {
+                                renderInvalidate(render);
+                                continue;
                         }
-                        break;
-                case KEY_RIGHT:
-                        col++;
-                        if (col >= b->cols) {
-                                col = 0;
+
+                        if (winner != PLAYER_NA) {
+                                // give users some time to check the result and
+                                // then quit. two keys to avoid accident.
+                                if (--keys_to_quit == 0) goto exit;
+                                continue;
                         }
-                        break;
-                case ' ':
-                        row = boardRowForCol(b, col);
-                        if (row == -1) {
-                                // will try again.
-                                err_msg = ERR_MSG_COL_FULL;
+
+                        // the remaining keys are for humans only.
+                        if (bot_is_playing) continue;
+
+                        switch (ch) {
+                        case KEY_LEFT:
+                                col--;
+                                if (col < 0) {
+                                        col = b->cols - 1;
+                                }
                                 break;
-                        }
-                        err = boardSet(b, row, col, color, 0);
-                        if (OK != err) {
-                                err = errEmitNote(
-                                    "unexpected error during placing stone for "
-                                    "the user.");
-                                goto exit;
-                        }
+                        case KEY_RIGHT:
+                                col++;
+                                if (col >= b->cols) {
+                                        col = 0;
+                                }
+                                break;
+                        case ' ':
+                                row = boardRowForCol(b, col);
+                                if (row == -1) {
+                                        // will try again.
+                                        err_msg = ERR_MSG_COL_FULL;
+                                        break;
+                                }
+                                err = boardSet(b, row, col, color, 0);
+                                if (OK != err) {
+                                        err = errEmitNote(
+                                            "unexpected error during placing "
+                                            "stone for the user.");
+                                        goto exit;
+                                }
 
-                        prev_row = row;
-                        prev_col = col;
+                                prev_row = row;
+                                prev_col = col;
+                                last_bot = NULL;
 
-                        color =
-                            color == PLAYER_BLACK ? PLAYER_WHITE : PLAYER_BLACK;
-                        winner = boardWinner(b);
-                        break;
-                default:;
+                                color  = color == PLAYER_BLACK ? PLAYER_WHITE
+                                                               : PLAYER_BLACK;
+                                winner = boardWinner(b);
+                                moved  = 1;
+                                break;
+                        default:;
+                        }
                 }
         }
 
 exit:
+        // the bot can not be interrupted; wait for its move.
+        if (bot_running) {
+                renderLine(render, LINE_MSG, COLOR_PAIR(COLOR_BOT),
+                           "waiting for the bot to finish...");
+                renderFlush(render);
+                pthread_join(job.tid, NULL);
+        }
+
+        renderFree(render);
         finalizeScr();
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        boardFree(job.b);
+        sdsFree(msg);
+        sdsFree(summary);
         if (final_winner != NULL) {
                 *final_winner = winner;
         }
@@ -18,6 +18,9 @@
 //   - final_winner: if not NULL, set as enum player_t (NA means users cancel
 //   the game).
 //
+// Bots play on a separate thread with a copy of the board, while the runner
+// keeps serving keys and the clock of the bot.
+//
 // Return value:
 //   same as error_t.
 error_t runner(struct board_t *b, struct bot_t *bot_black,
@@ -0,0 +1,333 @@
+#include "selfplay.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>  // memcpy
+#include <time.h>
+#include <unistd.h>  // sysconf
+
+// eva
+#include <adt/sds.h>
+#include <rng/srng64.h>
+
+// bb
+#include "clock.h"
+#include "mcts.h"
+#include "replay.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define HEADER_SIZE 16
+
+// how often the calling thread checks the workers.
+#define WAIT_NS (100 * 1000 * 1000)
+
+// state shared by all workers.
+struct shared_t {
+        const struct selfplay_opts_t *opts;
+        const struct board_t         *empty;
+
+        atomic_int next_game;
+        atomic_int done_workers;
+        atomic_int failed;
+
+        _Atomic(uint64_t) games;
+        _Atomic(uint64_t) samples;
+        _Atomic(uint64_t) bytes;
+        _Atomic(uint64_t) wins[3];
+};
+
+struct worker_t {
+        struct shared_t *s;
+        int              id;
+        pthread_t        tid;
+
+        struct mcts_t  *mcts;     // owned.
+        struct rng64_t *rng;      // owned. for the opening moves.
+        struct board_t *b;        // owned.
+        uint32_t       *visits;   // owned. [cols]
+        uint8_t        *samples;  // owned. [rows * cols] of 'stride' bytes.
+        size_t          stride;   // bytes per sample.
+
+        FILE  *f;            // current shard. NULL before the first game.
+        int    shard;        // index of the next shard.
+        size_t shard_bytes;  // written to the current shard.
+};
+
+static struct selfplay_sample_t *
+sampleAt(struct worker_t *w, int i)
+{
+        return (struct selfplay_sample_t *)(w->samples + i * w->stride);
+}
+
+// closes the current shard, if any, and starts the next one.
+static error_t
+shardNext(struct worker_t *w)
+{
+        const struct selfplay_opts_t *opts = w->s->opts;
+
+        if (w->f != NULL && fclose(w->f) != 0) {
+                w->f = NULL;
+                return errNew("failed to close shard %d of worker %d.",
+                              w->shard - 1, w->id);
+        }
+
+        sds_t path = sdsEmpty();
+        sdsCatPrintf(&path, "%s-%d-%d.bin", opts->prefix, w->id, w->shard++);
+        w->f = fopen(path, "wb");
+        if (w->f == NULL) {
+                error_t err = errNew("failed to open %s.", path);
+                sdsFree(path);
+                return err;
+        }
+        sdsFree(path);
+
+        const uint32_t size                = w->stride;
+        uint8_t        header[HEADER_SIZE] = {
+            'B', 'B', 'S', 'P', SELFPLAY_VERSION,
+            opts->rows, opts->cols, opts->num_to_win,
+        };
+        memcpy(header + 8, &size, sizeof(size));
+        if (fwrite(header, HEADER_SIZE, 1, w->f) != 1) {
+                return errNew("failed to write shard header.");
+        }
+        w->shard_bytes = HEADER_SIZE;
+        atomic_fetch_add(&w->s->bytes, HEADER_SIZE);
+        return OK;
+}
+
+// writes the 'ply' samples of the last game.
+static error_t
+shardWrite(struct worker_t *w, int ply)
+{
+        const struct selfplay_opts_t *opts = w->s->opts;
+
+        // rotate between games only, so no game spans two shards.
+        if (w->f == NULL ||
+            (opts->shard_bytes > 0 && w->shard_bytes >= opts->shard_bytes)) {
+                error_t err = shardNext(w);
+                if (err) return err;
+        }
+        if (fwrite(w->samples, w->stride, ply, w->f) != (size_t)ply) {
+                return errNew("failed to write samples.");
+        }
+
+        const size_t bytes = ply * w->stride;
+        w->shard_bytes += bytes;
+        atomic_fetch_add(&w->s->bytes, bytes);
+        return OK;
+}
+
+// picks the column to play: proportionally to the visits during the opening,
+// the search's choice after.
+static int
+pickCol(struct worker_t *w, int ply, int col, uint32_t sum)
+{
+        if (ply >= w->s->opts->temp_plies || sum == 0) return col;
+
+        uint32_t x = rng64NextUint64(w->rng) % sum;
+        for (int c = 0; c < w->s->opts->cols; c++) {
+                if (x < w->visits[c]) return c;
+                x -= w->visits[c];
+        }
+        return col;
+}
+
+// plays one game and writes its samples.
+static error_t
+playGame(struct worker_t *w)
+{
+        const struct selfplay_opts_t *opts = w->s->opts;
+        struct board_t               *b    = w->b;
+
+        boardCopy(b, w->s->empty);
+
+        enum player_t next   = PLAYER_BLACK;
+        enum player_t winner = PLAYER_NA;
+        int           ply    = 0;
+        error_t       err;
+
+        while (winner == PLAYER_NA) {
+                int col;
+                err = mctsSearch(w->mcts, b, next, &col);
+                if (err) return errEmitNote("search failed at ply %d.", ply);
+
+                struct selfplay_sample_t *s   = sampleAt(w, ply);
+                const uint32_t            sum = mctsRootVisits(w->mcts,
+                                                               w->visits);
+
+                s->next   = next;
+                s->result = 0;
+                s->ply    = ply;
+                s->cols   = b->cols;
+                boardSnapshot(b, selfplaySampleStones(s));
+                for (int c = 0; c < b->cols; c++) {
+                        s->policy[c] = sum > 0 ? (float)w->visits[c] / sum
+                                               : c == col;
+                }
+
+                col     = pickCol(w, ply, col, sum);
+                int row = boardRowForCol(b, col);
+                boardSet(b, row, col, next, 0);
+                winner = boardWinnerAt(b, row, col);
+                next   = NEXT_PLAYER(next);
+                ply++;
+        }
+
+        for (int i = 0; i < ply; i++) {
+                struct selfplay_sample_t *s = sampleAt(w, i);
+                s->result = winner == PLAYER_TIE ? 0
+                            : winner == s->next  ? 1
+                                                 : -1;
+        }
+
+        if (opts->replay != NULL) {
+                replayAppend(opts->replay, sampleAt(w, 0), ply);
+        }
+        if (opts->prefix != NULL) {
+                err = shardWrite(w, ply);
+                if (err) return err;
+        }
+
+        atomic_fetch_add(&w->s->samples, ply);
+        atomic_fetch_add(&w->s->games, 1);
+        atomic_fetch_add(&w->s->wins[winner == PLAYER_BLACK   ? 0
+                                     : winner == PLAYER_WHITE ? 1
+                                                              : 2],
+                         1);
+        return OK;
+}
+
+static void *
+workerRun(void *arg)
+{
+        struct worker_t *w = arg;
+        struct shared_t *s = w->s;
+
+        while (!atomic_load(&s->failed)) {
+                int i = atomic_fetch_add(&s->next_game, 1);
+                if (i >= s->opts->games) break;
+
+                if (playGame(w)) {
+                        errEmitNote("worker %d failed at game %d.", w->id, i);
+                        atomic_store(&s->failed, 1);
+                }
+        }
+
+        if (w->f != NULL && fclose(w->f) != 0) atomic_store(&s->failed, 1);
+        w->f = NULL;
+        atomic_fetch_add(&s->done_workers, 1);
+        return NULL;
+}
+
+static void
+statsLoad(struct shared_t *s, uint64_t start_ns, struct selfplay_stats_t *st)
+{
+        st->games   = atomic_load(&s->games);
+        st->samples = atomic_load(&s->samples);
+        st->bytes   = atomic_load(&s->bytes);
+        for (int i = 0; i < 3; i++) st->wins[i] = atomic_load(&s->wins[i]);
+        st->wall_ns = nowNs() - start_ns;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+size_t
+selfplaySampleSize(const struct board_t *b)
+{
+        const size_t stones = boardSnapshotSize(b);
+        if (stones == 0) return 0;
+        return sizeof(struct selfplay_sample_t) + b->cols * sizeof(float) +
+               stones;
+}
+
+error_t
+selfplayRun(const struct selfplay_opts_t *opts, struct selfplay_stats_t *stats)
+{
+        memset(stats, 0, sizeof(*stats));
+
+        if (opts->cols > UINT8_MAX) {
+                return errNew("too many columns for self-play: %d",
+                              opts->cols);
+        }
+
+        struct board_t *empty =
+            boardNew(opts->rows, opts->cols, opts->num_to_win, 1);
+        const size_t stride = selfplaySampleSize(empty);
+        if (stride == 0) {
+                boardFree(empty);
+                return errNew("board too large for samples: %dx%d",
+                              opts->rows, opts->cols);
+        }
+
+        int threads = opts->threads;
+        if (threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (threads <= 0) threads = 1;
+
+        struct shared_t s = {.opts = opts, .empty = empty};
+        atomic_init(&s.next_game, 0);
+        atomic_init(&s.done_workers, 0);
+        atomic_init(&s.failed, 0);
+
+        const struct mcts_opts_t mcts_opts = {.playouts = opts->playouts};
+        struct worker_t *workers = calloc(threads, sizeof(struct worker_t));
+        const uint64_t   start   = nowNs();
+
+        int started = 0;
+        for (; started < threads; started++) {
+                struct worker_t *w = &workers[started];
+                const uint64_t   seed =
+                    opts->seed + 0x9e3779b97f4a7c15ULL * (started + 1);
+
+                w->s       = &s;
+                w->id      = started;
+                w->mcts    = mctsNew(&mcts_opts, seed, /*tt=*/NULL);
+                w->rng     = srng64New(seed ^ 0xff51afd7ed558ccdULL);
+                w->b       = boardNew(opts->rows, opts->cols,
+                                      opts->num_to_win, 1);
+                w->visits  = malloc(opts->cols * sizeof(uint32_t));
+                w->stride  = stride;
+                w->samples = malloc(opts->rows * opts->cols * stride);
+                if (pthread_create(&w->tid, NULL, workerRun, w)) {
+                        atomic_store(&s.failed, 1);
+                        break;
+                }
+        }
+
+        // report progress until all workers are done.
+        uint64_t last = start;
+        while (atomic_load(&s.done_workers) < started) {
+                struct timespec wait = {.tv_nsec = WAIT_NS};
+                nanosleep(&wait, NULL);
+
+                if (opts->on_progress != NULL && nowNs() - last >= 1000000000) {
+                        last = nowNs();
+                        statsLoad(&s, start, stats);
+                        opts->on_progress(stats, opts->ctx);
+                }
+        }
+
+        for (int i = 0; i < threads; i++) {
+                struct worker_t *w = &workers[i];
+                if (w->mcts == NULL) break;  // not created.
+
+                if (i < started) pthread_join(w->tid, NULL);
+                mctsFree(w->mcts);
+                rng64Free(w->rng);
+                boardFree(w->b);
+                free(w->visits);
+                free(w->samples);
+        }
+        free(workers);
+        boardFree(empty);
+
+        statsLoad(&s, start, stats);
+        if (atomic_load(&s.failed)) return errNew("self-play failed.");
+        return OK;
+}
@@ -0,0 +1,95 @@
+#ifndef BB_SELFPLAY_H_
+#define BB_SELFPLAY_H_
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+
+// bb
+#include "board.h"
+
+// -----------------------------------------------------------------------------
+// Self-play data generation.
+// -----------------------------------------------------------------------------
+//
+// Worker threads play games of an MCTS bot against itself and record one
+// sample per position: the stones, the visit distribution of the root search,
+// and the final result for the side to move. Each worker keeps the samples of
+// its current game only and streams finished games to its own shard files, so
+// memory stays bounded by threads * rows * cols samples. Finished games can
+// also go to a replay buffer (see src/replay.h) for a concurrent trainer.
+//
+// A sample is struct selfplay_sample_t followed by its stones, a board
+// snapshot (see boardSnapshot). Samples are packed at the stride of
+// selfplaySampleSize, e.g., 48 bytes on 6x7, in memory and in files.
+//
+// Shard files are named "<prefix>-<worker>-<shard>.bin" and rotate once they
+// reach 'shard_bytes'. Each starts with a 16-byte header:
+//
+//   "BBSP", version u8, rows u8, cols u8, num_to_win u8,
+//   selfplaySampleSize u32, reserved u32
+//
+// followed by raw samples in host byte order.
+
+#define SELFPLAY_VERSION 3
+
+struct selfplay_sample_t {
+        int8_t  next;    // side to move. enum player_t
+        int8_t  result;  // for 'next': 1 win, 0 draw, -1 loss.
+        uint8_t ply;     // stones on the board.
+        uint8_t cols;    // entries of 'policy'.
+
+        // visits of the root moves by column, normalized. [cols]
+        float policy[];
+};
+
+struct replay_t;
+
+struct selfplay_stats_t {
+        uint64_t games;
+        uint64_t samples;
+        uint64_t bytes;    // written, including headers.
+        uint64_t wins[3];  // black, white, draws.
+        uint64_t wall_ns;
+};
+
+struct selfplay_opts_t {
+        int rows;
+        int cols;
+        int num_to_win;
+
+        int      games;
+        int      threads;     // 0 => one per online cpu.
+        int      playouts;    // per move. 0 => mcts default.
+        int      temp_plies;  // plies played proportionally to the visits.
+        uint64_t seed;
+
+        const char *prefix;       // of the shard paths. NULL => no files.
+        size_t      shard_bytes;  // 0 => no rotation.
+
+        struct replay_t *replay;  // unowned. NULL-able. gets all samples.
+
+        // called about every second from the calling thread, if not NULL.
+        void (*on_progress)(const struct selfplay_stats_t *, void *ctx);
+        void *ctx;
+};
+
+// Returns the stride of the samples of 'b', i.e., the header, the policy and
+// the stones. 0 if 'b' cannot be snapshotted.
+extern size_t selfplaySampleSize(const struct board_t *b);
+
+// Returns the stones of 's', boardSnapshotSize bytes, unaligned.
+static inline void *
+selfplaySampleStones(struct selfplay_sample_t *s)
+{
+        return &s->policy[s->cols];
+}
+
+// Plays 'opts->games' games and fills 'stats'. Blocks until all workers are
+// done.
+extern error_t selfplayRun(const struct selfplay_opts_t *opts,
+                           _out_ struct selfplay_stats_t *stats);
+
+#endif  // BB_SELFPLAY_H_
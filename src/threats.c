@@ -0,0 +1,114 @@
+#include "threats.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+// returns the number of columns where 'p' wins by playing now. the first one
+// is filled in 'col' if not NULL.
+static int
+immediateWins(struct board_t *b, enum player_t p, int *col)
+{
+        int count = 0;
+        for (int c = 0; c < b->cols; c++) {
+                int row = boardRowForCol(b, c);
+                if (row == -1) continue;
+
+                boardSet(b, row, c, p, 0);
+                if (boardWinnerAt(b, row, c) == p) {
+                        if (count++ == 0 && col != NULL) *col = c;
+                }
+                boardSet(b, row, c, PLAYER_NA, 0);
+        }
+        return count;
+}
+
+// returns 1 if 'me', to move, wins with at most 'depth' threats, and the first
+// move in 'col'.
+static int
+forcedWin(struct board_t *b, enum player_t me, int depth, int *col)
+{
+        if (immediateWins(b, me, col)) return 1;
+        if (depth == 0) return 0;
+
+        const enum player_t opp = NEXT_PLAYER(me);
+
+        // an opponent threat must be blocked first; two cannot be.
+        int block;
+        int opp_wins = immediateWins(b, opp, &block);
+        if (opp_wins > 1) return 0;
+
+        for (int c = 0; c < b->cols; c++) {
+                if (opp_wins == 1 && c != block) continue;
+
+                int row = boardRowForCol(b, c);
+                if (row == -1) continue;
+
+                boardSet(b, row, c, me, 0);
+
+                // a threat forces the block unless the opponent wins first.
+                int found = 0;
+                int reply, next_col;
+                if (boardWinnerAt(b, row, c) == PLAYER_NA &&
+                    immediateWins(b, opp, NULL) == 0) {
+                        int threats = immediateWins(b, me, &reply);
+                        if (threats > 1) {
+                                found = 1;
+                        } else if (threats == 1) {
+                                int r = boardRowForCol(b, reply);
+                                boardSet(b, r, reply, opp, 0);
+                                found = boardWinnerAt(b, r, reply) ==
+                                            PLAYER_NA &&
+                                        forcedWin(b, me, depth - 1, &next_col);
+                                boardSet(b, r, reply, PLAYER_NA, 0);
+                        }
+                }
+
+                boardSet(b, row, c, PLAYER_NA, 0);
+                if (found) {
+                        *col = c;
+                        return 1;
+                }
+        }
+        return 0;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+int
+threatsSearch(struct board_t *b, enum player_t next, int depth, int *col)
+{
+        const enum player_t opp = NEXT_PLAYER(next);
+        int                 c;
+
+        if (forcedWin(b, next, depth, col)) return THREATS_WIN;
+
+        // an immediate threat has a single answer.
+        if (immediateWins(b, opp, col)) return THREATS_BLOCK;
+
+        if (!forcedWin(b, opp, depth, &c)) return THREATS_NONE;
+
+        // the first move, center out, after which the opponent has no
+        // sequence left.
+        const int cols = b->cols;
+        for (int i = 0; i < cols; i++) {
+                c = cols / 2 + (i % 2 ? -(i + 1) / 2 : i / 2);
+
+                int row = boardRowForCol(b, c);
+                if (row == -1) continue;
+
+                boardSet(b, row, c, next, 0);
+                int dummy;
+                int stops = boardWinnerAt(b, row, c) == PLAYER_NA &&
+                            !forcedWin(b, opp, depth, &dummy);
+                boardSet(b, row, c, PLAYER_NA, 0);
+
+                if (stops) {
+                        *col = c;
+                        return THREATS_BLOCK;
+                }
+        }
+        return THREATS_NONE;  // lost against best play; nothing to block.
+}
@@ -0,0 +1,38 @@
+#ifndef BB_THREATS_H_
+#define BB_THREATS_H_
+
+// bb
+#include "board.h"
+
+// -----------------------------------------------------------------------------
+// Threat-space search.
+// -----------------------------------------------------------------------------
+//
+// A narrow search over forcing moves only. The attacker plays moves that
+// threaten to win on the next move; the defender is assumed to block, which is
+// its only move unless it can win first. A sequence ending in two threats at
+// once (or a threat the block cannot stop) is a forced win.
+//
+// With so few branches the search takes microseconds, so bots can run it
+// before their own search to never miss a win or a forced block.
+
+#define THREATS_NONE  0  // nothing forced.
+#define THREATS_WIN   1  // 'col' wins, now or through a sequence of threats.
+#define THREATS_BLOCK 2  // 'col' stops a win of the opponent.
+
+// Default number of attacker moves in a sequence.
+#define THREATS_DEPTH 8
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+// Searches the position 'b' with 'next' to play, allowing up to 'depth' threats
+// per sequence. Returns THREATS_* and fills 'col' unless THREATS_NONE.
+//
+// Only boards with gravity (mode 1) are supported. 'b' is modified during the
+// search and restored on return.
+extern int threatsSearch(struct board_t *b, enum player_t next, int depth,
+                         _out_ int *col);
+
+#endif  // BB_THREATS_H_
@@ -0,0 +1,241 @@
+#include "trace.h"
+
+#ifdef BB_TRACE
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>  // calloc
+#include <time.h>    // nanosleep
+
+// -----------------------------------------------------------------------------
+// registry.
+// -----------------------------------------------------------------------------
+
+_Thread_local struct trace_ring_t *trace_ring = NULL;
+
+// rings are never freed, so events of finished threads can still be dumped.
+static _Atomic(struct trace_ring_t *) rings    = NULL;
+static atomic_int                     num_tids = 0;
+
+static const char *names[TRACE_NUM_NAMES] = {
+    [TRACE_BOT_MOVE] = "move",     [TRACE_SEARCH] = "search",
+    [TRACE_SELECT] = "select",     [TRACE_EXPAND] = "expand",
+    [TRACE_PLAYOUT] = "playout",   [TRACE_BACKUP] = "backup",
+    [TRACE_TT_PROBE] = "tt_probe", [TRACE_LOCK_WAIT] = "lock_wait",
+    [TRACE_EVAL] = "eval",
+};
+
+struct trace_ring_t *
+traceRegister(void)
+{
+        struct trace_ring_t *r = calloc(1, sizeof(*r));
+        r->tid                 = atomic_fetch_add(&num_tids, 1) + 1;
+
+        // lock-free push.
+        r->next = atomic_load(&rings);
+        while (!atomic_compare_exchange_weak(&rings, &r->next, r)) {
+        }
+
+        trace_ring = r;
+        return r;
+}
+
+// -----------------------------------------------------------------------------
+// writing.
+// -----------------------------------------------------------------------------
+
+// writes 'n' events of thread 'tid'. 'open' counts the begin events written
+// without their end; an end event without one is dropped.
+static void
+writeEvents(FILE *f, const struct trace_event_t *events, uint64_t n, int tid,
+            int *open, int *first)
+{
+        for (uint64_t i = 0; i < n; i++) {
+                const struct trace_event_t *e = &events[i];
+                if (e->phase == 'E') {
+                        if (*open == 0) continue;
+                        (*open)--;
+                } else {
+                        (*open)++;
+                }
+
+                // microseconds, formatted without floating point.
+                fprintf(f,
+                        "%s\n{\"name\":\"%s\",\"ph\":\"%c\","
+                        "\"ts\":%llu.%03llu,\"pid\":1,\"tid\":%d}",
+                        *first ? "" : ",", names[e->name], (char)e->phase,
+                        (unsigned long long)(e->ts / 1000),
+                        (unsigned long long)(e->ts % 1000), tid);
+                *first = 0;
+        }
+}
+
+// copies the events [from, to) of 'r' out of the ring.
+static void
+copyEvents(const struct trace_ring_t *r, uint64_t from, uint64_t to,
+           struct trace_event_t *out)
+{
+        for (uint64_t i = from; i < to; i++) {
+                out[i - from] = r->events[i & (TRACE_RING_SIZE - 1)];
+        }
+}
+
+// -----------------------------------------------------------------------------
+// drain.
+// -----------------------------------------------------------------------------
+
+static FILE      *drain_file = NULL;
+static pthread_t  drain_thread;
+static atomic_int drain_stop = 0;
+static int        drain_first;
+static uint64_t   drain_lost;
+
+// copied out of a ring being written. only used by the drain.
+static struct trace_event_t drain_events[TRACE_RING_SIZE];
+
+// writes the events of 'r' since the last drain. the thread of 'r' may be
+// recording meanwhile: the events are copied first, then kept only if their
+// slots were not rewritten during the copy, as for a seqlock.
+static void
+drainRing(struct trace_ring_t *r)
+{
+        const uint64_t head =
+            atomic_load_explicit(&r->head, memory_order_acquire);
+        uint64_t from = r->drained;
+        if (head - from > TRACE_RING_SIZE) from = head - TRACE_RING_SIZE;
+        copyEvents(r, from, head, drain_events);
+
+        // the slot of event i is rewritten from head i + TRACE_RING_SIZE on.
+        atomic_thread_fence(memory_order_acquire);
+        const uint64_t now =
+            atomic_load_explicit(&r->head, memory_order_relaxed);
+        uint64_t start = from;
+        if (now >= TRACE_RING_SIZE && now - TRACE_RING_SIZE + 1 > start) {
+                start = now - TRACE_RING_SIZE + 1;
+        }
+        if (start > head) start = head;
+
+        if (start > r->drained) {
+                drain_lost += start - r->drained;
+                r->open = 0;  // their end events may be among the lost ones.
+        }
+        writeEvents(drain_file, drain_events + (start - from), head - start,
+                    r->tid, &r->open, &drain_first);
+        r->drained = head;
+}
+
+static void
+drainAll(void)
+{
+        for (struct trace_ring_t *r = atomic_load(&rings); r != NULL;
+             r = r->next) {
+                drainRing(r);
+        }
+        fflush(drain_file);
+}
+
+static void *
+drainLoop(void *arg)
+{
+        (void)arg;
+        const struct timespec period = {
+            .tv_sec  = TRACE_DRAIN_NS / 1000000000,
+            .tv_nsec = TRACE_DRAIN_NS % 1000000000,
+        };
+        while (!atomic_load(&drain_stop)) {
+                drainAll();
+                nanosleep(&period, NULL);
+        }
+        return NULL;
+}
+
+int
+traceOpen(const char *path)
+{
+        if (drain_file != NULL) return -1;
+
+        FILE *f = fopen(path, "w");
+        if (f == NULL) return -1;
+        fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+        // only the events recorded from now on.
+        for (struct trace_ring_t *r = atomic_load(&rings); r != NULL;
+             r = r->next) {
+                r->drained = atomic_load(&r->head);
+                r->open    = 0;
+        }
+
+        drain_file  = f;
+        drain_first = 1;
+        drain_lost  = 0;
+        atomic_store(&drain_stop, 0);
+        if (pthread_create(&drain_thread, NULL, drainLoop, NULL) != 0) {
+                drain_file = NULL;
+                fclose(f);
+                return -1;
+        }
+        return 0;
+}
+
+int
+traceClose(void)
+{
+        if (drain_file == NULL) return -1;
+
+        atomic_store(&drain_stop, 1);
+        pthread_join(drain_thread, NULL);
+        drainAll();
+
+        FILE *f    = drain_file;
+        drain_file = NULL;
+        fprintf(f, "\n],\"lostEvents\":%llu}\n",
+                (unsigned long long)drain_lost);
+        return fclose(f) == 0 ? 0 : -1;
+}
+
+// -----------------------------------------------------------------------------
+// dump.
+// -----------------------------------------------------------------------------
+
+int
+traceDump(const char *path)
+{
+        FILE *f = fopen(path, "w");
+        if (f == NULL) return -1;
+
+        fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+        int first = 1;
+        for (struct trace_ring_t *r = atomic_load(&rings); r != NULL;
+             r = r->next) {
+                // the oldest event still in the ring.
+                const uint64_t head  = atomic_load(&r->head);
+                const uint64_t start = head > TRACE_RING_SIZE
+                                           ? head - TRACE_RING_SIZE
+                                           : 0;
+                int            open  = 0;
+
+                // in order, as the ring may wrap around.
+                for (uint64_t i = start; i < head; i++) {
+                        writeEvents(f, &r->events[i & (TRACE_RING_SIZE - 1)],
+                                    1, r->tid, &open, &first);
+                }
+        }
+
+        fprintf(f, "\n]}\n");
+        return fclose(f) == 0 ? 0 : -1;
+}
+
+void
+traceClear(void)
+{
+        for (struct trace_ring_t *r = atomic_load(&rings); r != NULL;
+             r = r->next) {
+                atomic_store(&r->head, 0);
+                r->drained = 0;
+                r->open    = 0;
+        }
+}
+
+#endif  // BB_TRACE
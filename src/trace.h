@@ -0,0 +1,130 @@
+#ifndef BB_TRACE_H_
+#define BB_TRACE_H_
+
+// -----------------------------------------------------------------------------
+// Timeline tracing.
+// -----------------------------------------------------------------------------
+//
+// Begin/end events around the search phases, dumped as Chrome trace_event
+// JSON (load it in chrome://tracing or Perfetto).
+//
+// Each thread appends to its own ring buffer, so recording is a clock read
+// and a 16-byte store without any synchronization; when a ring is full, the
+// oldest events are overwritten.
+//
+// A long run, e.g., a match, is recorded in full with TRACE_OPEN: a
+// background thread drains the new events of all rings into the file every
+// TRACE_DRAIN_NS, well before the rings wrap around, until TRACE_CLOSE. A
+// ring may still wrap around under a burst, or if the drain gets no core;
+// the events lost are counted in the "lostEvents" field of the file.
+// TRACE_DUMP instead writes what the rings hold and must only be called while
+// no traced thread is running, e.g., after a move as the runner does.
+//
+// In both cases, an end event whose begin event was overwritten is dropped,
+// so the viewer does not pair it with an unrelated begin event.
+//
+// Tracing is compiled in with -DBB_TRACE (make TRACE=1). Otherwise, all macros
+// expand to nothing, except TRACE_DUMP, TRACE_OPEN and TRACE_CLOSE, which
+// expand to 0, i.e., success, so callers check them the same way in both
+// builds.
+
+// Event names.
+enum trace_name_t {
+        TRACE_BOT_MOVE = 0,  // a bot move, in botPlay. TRACE_MOVE is ncurses'.
+        TRACE_SEARCH,        // a full search.
+        TRACE_SELECT,        // mcts selection, down to a leaf.
+        TRACE_EXPAND,        // mcts node expansion.
+        TRACE_PLAYOUT,       // mcts random playout.
+        TRACE_BACKUP,        // mcts backup of results, amaf and proofs.
+        TRACE_TT_PROBE,      // transposition table probe.
+        TRACE_LOCK_WAIT,     // waiting for a lock.
+        TRACE_EVAL,          // batched leaf evaluation of puct.
+        TRACE_NUM_NAMES,
+};
+
+#ifdef BB_TRACE
+
+#include <stdatomic.h>
+#include <stdint.h>  // uint64_t
+
+// bb
+#include "clock.h"
+
+// events per thread. power of 2.
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE (1 << 16)
+#endif
+
+// period of the background drain.
+#ifndef TRACE_DRAIN_NS
+#define TRACE_DRAIN_NS (10 * 1000 * 1000)
+#endif
+
+struct trace_event_t {
+        uint64_t ts;     // ns, monotonic clock.
+        uint32_t name;   // enum trace_name_t
+        uint32_t phase;  // 'B' or 'E'.
+};
+
+struct trace_ring_t {
+        _Atomic(uint64_t)     head;  // events ever written.
+        int                   tid;
+        struct trace_ring_t  *next;  // registry list.
+        struct trace_event_t  events[TRACE_RING_SIZE];
+
+        // owned by the drain.
+        uint64_t drained;  // events written to the file or lost.
+        int      open;     // begin events written without their end.
+};
+
+extern _Thread_local struct trace_ring_t *trace_ring;
+
+extern struct trace_ring_t *traceRegister(void);
+extern int                  traceDump(const char *path);
+extern void                 traceClear(void);
+extern int                  traceOpen(const char *path);
+extern int                  traceClose(void);
+
+static inline void
+traceEvent(uint32_t name, uint32_t phase)
+{
+        struct trace_ring_t *r = trace_ring;
+        if (r == NULL) r = traceRegister();
+
+        // only this thread writes 'head'; the release store publishes the
+        // event to the drain.
+        const uint64_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+        struct trace_event_t *e = &r->events[h & (TRACE_RING_SIZE - 1)];
+        e->ts                   = nowNs();
+        e->name                 = name;
+        e->phase                = phase;
+        atomic_store_explicit(&r->head, h + 1, memory_order_release);
+}
+
+#define TRACE_BEGIN(name) traceEvent((name), 'B')
+#define TRACE_END(name)   traceEvent((name), 'E')
+
+// Writes all rings to 'path'. Returns 0 on success.
+#define TRACE_DUMP(path) traceDump(path)
+
+// Drops all recorded events. No traced thread may run, nor the drain.
+#define TRACE_CLEAR() traceClear()
+
+// Starts draining all events recorded from now on into 'path', which is
+// truncated; TRACE_CLOSE stops and completes the file. One file at a time.
+// Both return 0 on success.
+#define TRACE_OPEN(path) traceOpen(path)
+#define TRACE_CLOSE()    traceClose()
+
+#else  // BB_TRACE
+
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name)   ((void)0)
+#define TRACE_DUMP(path)  0
+#define TRACE_CLEAR()     ((void)0)
+#define TRACE_OPEN(path)  0
+#define TRACE_CLOSE()     0
+
+#endif  // BB_TRACE
+
+#endif  // BB_TRACE_H_
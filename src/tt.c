@@ -0,0 +1,226 @@
+#include "tt.h"
+
+#include <assert.h>
+#include <stdlib.h>    // calloc
+#include <string.h>    // memcpy
+#include <sys/mman.h>  // mmap
+
+// bb
+#include "trace.h"
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+#define RELAXED memory_order_relaxed
+
+#define COUNT(stats, field)                            \
+        do {                                           \
+                if ((stats) != NULL) (stats)->field++; \
+        } while (0)
+
+static uint64_t
+pack(const struct tt_data_t *data)
+{
+        uint64_t v;
+        _Static_assert(sizeof(*data) == sizeof(v), "tt_data_t is 64 bits.");
+        memcpy(&v, data, sizeof(v));
+        return v;
+}
+
+static void
+unpack(uint64_t v, struct tt_data_t *data)
+{
+        memcpy(data, &v, sizeof(v));
+}
+
+// Tries explicit huge pages first, then asks for transparent huge pages.
+static void *
+allocBuckets(size_t bytes, int *huge_pages)
+{
+        void *p;
+
+#ifdef MAP_HUGETLB
+        if (bytes >= HUGE_PAGE_SIZE) {
+                p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (p != MAP_FAILED) {
+                        *huge_pages = 1;
+                        return p;
+                }
+        }
+#endif
+
+        *huge_pages = 0;
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return NULL;
+
+#ifdef MADV_HUGEPAGE
+        madvise(p, bytes, MADV_HUGEPAGE);  // best effort.
+#endif
+        return p;
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+struct tt_t *
+ttNew(size_t bytes, int policy)
+{
+        size_t num_buckets = 1;
+        while (num_buckets * 2 * sizeof(struct tt_bucket_t) <= bytes) {
+                num_buckets *= 2;
+        }
+
+        struct tt_t *tt = calloc(1, sizeof(*tt));
+        tt->num_buckets = num_buckets;
+        tt->bytes       = num_buckets * sizeof(struct tt_bucket_t);
+        tt->policy      = policy;
+        tt->buckets     = allocBuckets(tt->bytes, &tt->huge_pages);
+        if (tt->buckets == NULL) {
+                free(tt);
+                return NULL;
+        }
+        return tt;
+}
+
+void
+ttFree(struct tt_t *tt)
+{
+        if (tt == NULL) return;
+        munmap(tt->buckets, tt->bytes);
+        free(tt);
+}
+
+void
+ttClear(struct tt_t *tt)
+{
+        memset(tt->buckets, 0, tt->bytes);
+        atomic_store(&tt->age, 0);
+}
+
+void
+ttNewSearch(struct tt_t *tt)
+{
+        atomic_fetch_add_explicit(&tt->age, 1, RELAXED);
+}
+
+int
+ttProbe(struct tt_t *tt, uint64_t key, struct tt_data_t *data,
+        struct tt_stats_t *stats)
+{
+        struct tt_bucket_t *bk = &tt->buckets[key & (tt->num_buckets - 1)];
+        int                 others = 0;
+
+        COUNT(stats, probes);
+        TRACE_BEGIN(TRACE_TT_PROBE);
+
+        for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+                struct tt_entry_t *e = &bk->entries[i];
+                uint64_t           d = atomic_load_explicit(&e->data, RELAXED);
+                uint64_t kx = atomic_load_explicit(&e->key_xor_data, RELAXED);
+
+                if (d == 0) continue;  // empty.
+                if ((kx ^ d) == key) {
+                        unpack(d, data);
+                        COUNT(stats, hits);
+                        TRACE_END(TRACE_TT_PROBE);
+                        return 1;
+                }
+                others++;
+        }
+
+        if (others == TT_BUCKET_SIZE) COUNT(stats, collisions);
+        TRACE_END(TRACE_TT_PROBE);
+        return 0;
+}
+
+void
+ttStore(struct tt_t *tt, uint64_t key, const struct tt_data_t *data,
+        struct tt_stats_t *stats)
+{
+        assert(data->flag != 0);
+
+        struct tt_bucket_t *bk  = &tt->buckets[key & (tt->num_buckets - 1)];
+        const uint8_t       age = atomic_load_explicit(&tt->age, RELAXED);
+
+        struct tt_data_t cur;
+        int              slot  = -1;  // selected slot.
+        int              empty = -1;  // first empty slot.
+
+        // an entry is worth keeping if it is from this search and deep.
+#define WORTH(d) ((d).age == age ? 256 + (d).depth : (d).depth)
+
+        int victim       = -1;  // least worthy slot among depth-preferred ones.
+        int victim_worth = 0;
+
+        const int num_preferred = tt->policy == TT_POLICY_TWO_TIER
+                                      ? TT_BUCKET_SIZE - 1
+                                      : TT_BUCKET_SIZE;
+
+        for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+                struct tt_entry_t *e = &bk->entries[i];
+                uint64_t           d = atomic_load_explicit(&e->data, RELAXED);
+                uint64_t kx = atomic_load_explicit(&e->key_xor_data, RELAXED);
+
+                if (d == 0) {
+                        if (empty == -1) empty = i;
+                        continue;
+                }
+
+                unpack(d, &cur);
+                if ((kx ^ d) == key) {
+                        // same position. keep a deeper result from this
+                        // search unless told to always replace.
+                        if (tt->policy != TT_POLICY_ALWAYS && cur.age == age &&
+                            cur.depth > data->depth) {
+                                return;
+                        }
+                        slot = i;
+                        break;
+                }
+
+                if (i < num_preferred &&
+                    (victim == -1 || WORTH(cur) < victim_worth)) {
+                        victim       = i;
+                        victim_worth = WORTH(cur);
+                }
+        }
+
+        if (slot == -1 && empty != -1) slot = empty;
+
+        if (slot == -1) {
+                // the new entry is as worthy as if it was in this search.
+                const int worth = 256 + data->depth;
+                switch (tt->policy) {
+                case TT_POLICY_ALWAYS:
+                        slot = victim;
+                        break;
+                case TT_POLICY_DEPTH:
+                        if (victim_worth <= worth) slot = victim;
+                        break;
+                case TT_POLICY_TWO_TIER:
+                        slot = victim_worth <= worth ? victim
+                                                     : TT_BUCKET_SIZE - 1;
+                        break;
+                default:
+                        assert(0);
+                }
+                if (slot == -1) return;  // nothing worth evicting.
+                COUNT(stats, overwrites);
+        }
+
+#undef WORTH
+
+        struct tt_data_t copy = *data;
+        copy.age              = age;
+
+        uint64_t           d = pack(&copy);
+        struct tt_entry_t *e = &bk->entries[slot];
+        atomic_store_explicit(&e->data, d, RELAXED);
+        atomic_store_explicit(&e->key_xor_data, key ^ d, RELAXED);
+}
@@ -0,0 +1,102 @@
+#ifndef BB_TT_H_
+#define BB_TT_H_
+
+#include <stdatomic.h>
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+
+// -----------------------------------------------------------------------------
+// Transposition table.
+// -----------------------------------------------------------------------------
+//
+// A fixed-capacity hash table shared by all searches. Each bucket is one cache
+// line holding TT_BUCKET_SIZE entries. Accesses are lock-free: an entry stores
+// `key ^ data` next to `data`, so a torn write from a concurrent store fails
+// the key check on probe and reads as a miss.
+//
+// The table keeps no counters: a shared line bumped on every probe would
+// bounce between all searching threads. Each search passes its own
+// tt_stats_t instead, or NULL.
+
+// Entry flags. Zero is reserved for empty entries.
+#define TT_FLAG_EXACT 1  // value is exact.
+#define TT_FLAG_LOWER 2  // value is a lower bound (fail high).
+#define TT_FLAG_UPPER 3  // value is an upper bound (fail low).
+
+// Replacement policies, used when the bucket has no entry for the key.
+#define TT_POLICY_ALWAYS   0  // evict the oldest, shallowest entry.
+#define TT_POLICY_DEPTH    1  // evict only entries not deeper than the new one.
+#define TT_POLICY_TWO_TIER 2  // depth-preferred slots plus one always slot.
+
+#define TT_BUCKET_SIZE 4
+
+// Solved positions are stored as exact entries of TT_DEPTH_SOLVED with value
+// +/-(TT_SCORE_WIN - n) for the side to move, n being the plies to the end of
+// the game.
+#define TT_DEPTH_SOLVED 255
+#define TT_SCORE_WIN    30000
+
+// Move of entries without a best move, e.g., the proofs of a tree search.
+#define TT_NO_MOVE UINT8_MAX
+
+// Payload of an entry; packed into 64 bits.
+struct tt_data_t {
+        int32_t value;
+        uint8_t depth;
+        uint8_t flag;  // TT_FLAG_*. must be non-zero.
+        uint8_t move;  // best move, e.g., column. TT_NO_MOVE if none.
+        uint8_t age;   // filled by ttStore.
+};
+
+struct tt_entry_t {
+        _Atomic uint64_t key_xor_data;
+        _Atomic uint64_t data;
+};
+
+struct tt_bucket_t {
+        struct tt_entry_t entries[TT_BUCKET_SIZE];
+} __attribute__((aligned(64)));
+
+// Counters of one search, or of any caller summing them.
+struct tt_stats_t {
+        uint64_t probes;
+        uint64_t hits;
+        uint64_t collisions;  // misses with the bucket full of other keys.
+        uint64_t overwrites;  // stores evicting an entry of another key.
+};
+
+struct tt_t {
+        struct tt_bucket_t *buckets;      // owned.
+        size_t              num_buckets;  // power of 2.
+        size_t              bytes;        // allocated bytes.
+        int                 huge_pages;   // 1 if backed by huge pages.
+        int                 policy;       // TT_POLICY_*
+        _Atomic uint8_t     age;          // bumped per search.
+};
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+// Allocates a table using at most 'bytes' (rounded down to a power of 2
+// buckets). Huge pages are used when available.
+extern struct tt_t *ttNew(size_t bytes, int policy);
+extern void         ttFree(struct tt_t *tt);
+
+// Drops all entries.
+extern void ttClear(struct tt_t *tt);
+
+// Ages the table so entries from older searches are preferred for eviction.
+extern void ttNewSearch(struct tt_t *tt);
+
+// Returns 1 and fills 'data' if 'key' is found; 0 otherwise. Counts the
+// probe in 'stats', the counters of the calling search, if not NULL.
+extern int  ttProbe(struct tt_t *tt, uint64_t key,
+                    _out_ struct tt_data_t *data, struct tt_stats_t *stats);
+extern void ttStore(struct tt_t *tt, uint64_t key,
+                    const struct tt_data_t *data, struct tt_stats_t *stats);
+
+#endif  // BB_TT_H_
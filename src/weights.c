@@ -0,0 +1,182 @@
+#include "weights.h"
+
+#include <stdlib.h>  // malloc
+#include <string.h>  // memcpy
+
+// -----------------------------------------------------------------------------
+// helpers.
+// -----------------------------------------------------------------------------
+
+static void
+weightsFree(struct weights_t *w)
+{
+        if (w == NULL) return;
+        if (w->num > 0) free(w->data[0]);  // one block for all tensors.
+        free(w->data);
+        free(w->sizes);
+        free(w);
+}
+
+// frees the retired versions no reader can hold. requires 'mu'.
+static void
+reclaim(struct weights_handle_t *h)
+{
+        // the oldest epoch a reader is in. 0 => none.
+        uint64_t oldest = 0;
+        for (int i = 0; i < WEIGHTS_MAX_READERS; i++) {
+                const uint64_t e = atomic_load(&h->readers[i]);
+                if (e != 0 && (oldest == 0 || e < oldest)) oldest = e;
+        }
+
+        struct weights_t **link = &h->retired;
+        while (*link != NULL) {
+                struct weights_t *w = *link;
+                if (oldest != 0 && oldest <= w->epoch) {
+                        link = &w->next;
+                        continue;
+                }
+
+                *link = w->next;
+                weightsFree(w);
+                h->reclaimed++;
+                atomic_fetch_sub(&h->pending, 1);
+        }
+}
+
+// -----------------------------------------------------------------------------
+// public APIs.
+// -----------------------------------------------------------------------------
+
+struct weights_handle_t *
+weightsHandleNew(void)
+{
+        struct weights_handle_t *h = calloc(1, sizeof(*h));
+        atomic_init(&h->current, NULL);
+        atomic_init(&h->version, 0);
+        atomic_init(&h->epoch, 1);
+        atomic_init(&h->pending, 0);
+        for (int i = 0; i < WEIGHTS_MAX_READERS; i++) {
+                atomic_init(&h->readers[i], 0);
+                atomic_init(&h->used[i], 0);
+        }
+        pthread_mutex_init(&h->mu, NULL);
+        return h;
+}
+
+void
+weightsHandleFree(struct weights_handle_t *h)
+{
+        if (h == NULL) return;
+
+        while (h->retired != NULL) {
+                struct weights_t *w = h->retired;
+                h->retired          = w->next;
+                weightsFree(w);
+        }
+        weightsFree(atomic_load(&h->current));
+        pthread_mutex_destroy(&h->mu);
+        free(h);
+}
+
+int
+weightsReaderNew(struct weights_handle_t *h)
+{
+        for (int i = 0; i < WEIGHTS_MAX_READERS; i++) {
+                int expected = 0;
+                if (atomic_compare_exchange_strong(&h->used[i], &expected,
+                                                   1)) {
+                        return i;
+                }
+        }
+        return -1;
+}
+
+void
+weightsReaderFree(struct weights_handle_t *h, int reader)
+{
+        if (reader < 0) return;
+        atomic_store(&h->readers[reader], 0);
+        atomic_store(&h->used[reader], 0);
+}
+
+error_t
+weightsPublish(struct weights_handle_t *h, int num, const float *const *data,
+               const size_t *sizes, uint64_t *version)
+{
+        size_t total = 0;
+        for (int i = 0; i < num; i++) total += sizes[i];
+
+        // copied before taking the lock; readers never wait on it anyway.
+        struct weights_t *w = calloc(1, sizeof(*w));
+        w->num              = num;
+        w->sizes            = malloc(num * sizeof(*w->sizes));
+        w->data             = malloc(num * sizeof(*w->data));
+        float *block        = malloc(total * sizeof(float));
+        if (w->sizes == NULL || w->data == NULL || block == NULL) {
+                free(block);
+                free(w->data);
+                free(w->sizes);
+                free(w);
+                return errNew("failed to allocate %zu weights.", total);
+        }
+
+        for (int i = 0; i < num; i++) {
+                w->sizes[i] = sizes[i];
+                w->data[i]  = block;
+                memcpy(block, data[i], sizes[i] * sizeof(float));
+                block += sizes[i];
+        }
+
+        pthread_mutex_lock(&h->mu);
+        const uint64_t v      = ++h->published;
+        w->version            = v;
+        struct weights_t *old = atomic_exchange(&h->current, w);
+        atomic_store(&h->version, v);
+
+        // readers entering from now on see 'w'.
+        const uint64_t epoch = atomic_fetch_add(&h->epoch, 1);
+        if (old != NULL) {
+                old->epoch = epoch;
+                old->next  = h->retired;
+                h->retired = old;
+                atomic_fetch_add(&h->pending, 1);
+        }
+        reclaim(h);
+        pthread_mutex_unlock(&h->mu);
+
+        // 'w' may be retired and freed by now.
+        if (version != NULL) *version = v;
+        return OK;
+}
+
+struct weights_t *
+weightsReadBegin(struct weights_handle_t *h, int reader)
+{
+        atomic_store(&h->readers[reader], atomic_load(&h->epoch));
+        return atomic_load(&h->current);
+}
+
+void
+weightsReadEnd(struct weights_handle_t *h, int reader)
+{
+        atomic_store(&h->readers[reader], 0);
+
+        // the last reader of a retired version frees it, unless the lock is
+        // taken; the next publish or read end then does.
+        if (atomic_load(&h->pending) > 0 &&
+            pthread_mutex_trylock(&h->mu) == 0) {
+                reclaim(h);
+                pthread_mutex_unlock(&h->mu);
+        }
+}
+
+void
+weightsStats(struct weights_handle_t *h, struct weights_stats_t *stats)
+{
+        pthread_mutex_lock(&h->mu);
+        stats->version   = atomic_load(&h->version);
+        stats->published = h->published;
+        stats->reclaimed = h->reclaimed;
+        stats->retired   = atomic_load(&h->pending);
+        pthread_mutex_unlock(&h->mu);
+}
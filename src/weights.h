@@ -0,0 +1,111 @@
+#ifndef BB_WEIGHTS_H_
+#define BB_WEIGHTS_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t
+
+// eva
+#include <base/error.h>
+
+// -----------------------------------------------------------------------------
+// Versioned weights.
+// -----------------------------------------------------------------------------
+//
+// A handle to the latest weights of a network, swapped in RCU style so that
+// running bots pick up new checkpoints without pausing:
+//
+//   - the trainer publishes a copy of its weight tensors as a new version,
+//     which replaces the current one with one atomic store;
+//   - a reader, e.g., an nn_t loading the weights into its vm between two
+//     batches, brackets its use of a version with weightsReadBegin and
+//     weightsReadEnd. Both are wait-free, and an evaluation already running
+//     finishes on the weights it loaded;
+//   - a replaced version is retired and freed once no reader that could have
+//     seen it is still inside a read section.
+//
+// Readers announce the epoch they enter at in their own slot. A version
+// retired at epoch e is kept while a slot holds an epoch of at most e. All
+// these atomics are sequentially consistent: a reader entering after the
+// epoch moved past e also loads the newer version.
+//
+// Retired versions are freed by the next publish or by the reader ending the
+// last read section that held them, if the publisher lock is free.
+
+#define WEIGHTS_MAX_READERS 64
+
+// An immutable set of weight tensors.
+struct weights_t {
+        uint64_t version;  // 1 for the first publish.
+        int      num;      // tensors.
+        size_t  *sizes;    // owned. f32 values per tensor.
+        float  **data;     // owned. [num][sizes[i]]
+
+        uint64_t          epoch;  // at retirement.
+        struct weights_t *next;   // in the retired list.
+};
+
+struct weights_stats_t {
+        uint64_t version;    // current. 0 before the first publish.
+        uint64_t published;  //
+        uint64_t reclaimed;  // retired versions freed.
+        uint64_t retired;    // retired versions still held by readers.
+};
+
+struct weights_handle_t {
+        _Atomic(struct weights_t *) current;  // owned. NULL-able.
+        _Atomic(uint64_t)           version;  // of 'current'.
+        _Atomic(uint64_t)           epoch;    // starts at 1.
+
+        // epoch each reader entered its read section at. 0 => outside.
+        _Atomic(uint64_t) readers[WEIGHTS_MAX_READERS];
+        atomic_int        used[WEIGHTS_MAX_READERS];  // slots taken.
+        atomic_int        pending;                    // retired versions.
+
+        // serializes publishers and reclamation.
+        pthread_mutex_t   mu;
+        struct weights_t *retired;  // owned. guarded by mu.
+        uint64_t          published;
+        uint64_t          reclaimed;
+};
+
+// -----------------------------------------------------------------------------
+// prototypes
+// -----------------------------------------------------------------------------
+
+extern struct weights_handle_t *weightsHandleNew(void);
+
+// Frees all versions. No reader may be inside a read section.
+extern void weightsHandleFree(struct weights_handle_t *h);
+
+// Returns a free reader slot, or -1 if all WEIGHTS_MAX_READERS are taken. A
+// slot is used by one thread at a time.
+extern int  weightsReaderNew(struct weights_handle_t *h);
+extern void weightsReaderFree(struct weights_handle_t *h, int reader);
+
+// Publishes a copy of 'num' tensors of sizes[i] f32 values as the next
+// version, returned in 'version' if not NULL.
+extern error_t weightsPublish(struct weights_handle_t *h, int num,
+                              const float *const *data, const size_t *sizes,
+                              _out_ uint64_t *version);
+
+// Returns the current version, 0 before the first publish, without entering
+// a read section.
+static inline uint64_t
+weightsVersion(struct weights_handle_t *h)
+{
+        return atomic_load(&h->version);
+}
+
+// Returns the current weights, NULL before the first publish, which stay
+// valid until weightsReadEnd. Sections of one reader do not nest.
+extern struct weights_t *weightsReadBegin(struct weights_handle_t *h,
+                                          int reader);
+extern void              weightsReadEnd(struct weights_handle_t *h,
+                                        int reader);
+
+extern void weightsStats(struct weights_handle_t *h,
+                         _out_ struct weights_stats_t *stats);
+
+#endif  // BB_WEIGHTS_H_